@@ -9,6 +9,7 @@
 *
 */
 
+#include <algorithm>
 #include <map>
 #include <random>
 #include <fstream>
@@ -19,17 +20,29 @@
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(APPFL_PDES, "Messages specific for this example");
 
-using json = nlohmann::json;
+#include "FedCommon.hpp"
+
+// Created by main() before the actors, used by the clients around each exchange with the server.
+static ClientPipeline *pipeline = nullptr;
+
+// Created by main() before the actors, shared by the server, the clients and the population manager.
+static Population *population = nullptr;
 
 static void server(std::vector<std::string> args)
 {
-    xbt_assert(args.size() >= 5, "The server function expects at least 5 arguments");
+    xbt_assert(args.size() >= 11, "The server function expects at least 11 arguments");
 
     int client_count = std::stoi(args[0]);
     long epoch_count = std::stol(args[1]);
     double dataloader_cost = std::stod(args[2]);
     double aggregation_cost = std::stod(args[3]);
     double comm_cost = std::stod(args[4]);
+    json checkpoint_settings = json::parse(args[5]);
+    double validation_cost = std::stod(args[6]);
+    bool validation_flag = std::stoi(args[7]);
+    long validation_interval = std::stol(args[8]);
+    std::string validation_mode = args[9];
+    json memory_settings = json::parse(args[10]);
 
     simgrid::s4u::Host *host = simgrid::s4u::this_actor::get_host();
     double speed = host->get_speed();
@@ -43,14 +56,41 @@ static void server(std::vector<std::string> args)
 
     simgrid::s4u::this_actor::execute(dataloader_cost * speed); // simulate dataload and partitioning
 
+    Checkpointer checkpointer(checkpoint_settings, comm_cost);
+    Validator validator(validation_flag, validation_cost, validation_interval, validation_mode);
+    server_memory = new ServerMemory(memory_settings);
+    // round of the model each client trains, which sizes its upload under the payload schedule
+    std::vector<long> model_round(client_count, 0);
+
     for (size_t i = 0; i < client_count; i++)
     {
-        mailboxes[i]->put(new double(comm_cost), 4); // model size
-        mailboxes[i]->put(new double(1.0), comm_cost * 8);
+        if (!population->present(i))
+            continue;
+        intra_node->charge(i, payload->bytes(comm_cost * 8, 0, false));
+        payload->put(mailboxes[i], control_plane->model(comm_cost, 0), comm_cost * 8, 0, false);
+        latency->sent(i);
         simgrid::s4u::this_actor::execute(0.05 * speed); // comm overhead
         XBT_INFO("Step 1.%04zu: Broadcasting model to client %zu", i, i);
     }
 
+    // clients joining later get the current global model the same way
+    population->onboard = [mailboxes, comm_cost, speed, &model_round](int client_id) {
+        if (population->closed)
+        {
+            // the run ended while the client was starting up
+            control_plane->send(client_id, ServerMessage::TERMINATE);
+            population->retire(client_id);
+            return;
+        }
+        model_round[client_id] = payload->round;
+        intra_node->charge(client_id, payload->bytes(comm_cost * 8, payload->round, false));
+        payload->put(mailboxes[client_id], control_plane->model(comm_cost, payload->round), comm_cost * 8, payload->round, false);
+        latency->sent(client_id);
+        simgrid::s4u::this_actor::execute(0.05 * speed); // comm overhead
+        XBT_INFO("Step 1.%04d: Onboarded new client %d", client_id, client_id);
+    };
+    population->opened->release();
+
     int round = 0;
 
     while (round < client_count * epoch_count)
@@ -61,40 +101,68 @@ static void server(std::vector<std::string> args)
             continue;
         }
         int *client_id = mailboxes[client_count]->get<int>();
+        latency->arrived(*client_id);
+        server_memory->spill();
         simgrid::s4u::this_actor::execute(0.05 * speed); // comm overhead
         XBT_INFO("Step 4.%04d: Received model from client %d", *client_id, *client_id);
         simgrid::s4u::this_actor::execute(aggregation_cost * speed); // we use sleep for now to simulate model aggregation
-        // XBT_INFO("Step 1.%04zu:: Sending model to client %s", mailboxes[i]->get_cname());
-        mailboxes[*client_id]->put(new double(1), comm_cost * 8);
-        simgrid::s4u::this_actor::execute(0.15 * speed); // comm overhead
-        XBT_INFO("Step 1.%04d: Sent Model to client %d", *client_id, *client_id);
+        server_memory->release(payload->bytes(comm_cost * 8, model_round[*client_id], true));
+        if (population->leaving(*client_id))
+        {
+            control_plane->send(*client_id, ServerMessage::TERMINATE);
+            population->retire(*client_id);
+        }
+        else
+        {
+            // XBT_INFO("Step 1.%04zu:: Sending model to client %s", mailboxes[i]->get_cname());
+            model_round[*client_id] = round + 1;
+            intra_node->charge(*client_id, payload->bytes(comm_cost * 8, round + 1, false));
+            payload->put(mailboxes[*client_id], control_plane->model(comm_cost, round + 1), comm_cost * 8, round + 1, false);
+            latency->sent(*client_id);
+            simgrid::s4u::this_actor::execute(0.15 * speed); // comm overhead
+            XBT_INFO("Step 1.%04d: Sent Model to client %d", *client_id, *client_id);
+        }
         round++;
+        payload->round = round;
+        population->updates++;
+        progress = round;
+        checkpointer.step(round);
+        validator.step(round);
     }
 
     // XBT_INFO("All rounds have been completed. Requesting all clients to stop.");
+    population->closed = true;
     while(!mailboxes[client_count]->empty())
     {
         int* client_id = mailboxes[client_count]->get<int>();
+        latency->arrived(*client_id);
+        server_memory->release(payload->bytes(comm_cost * 8, model_round[*client_id], true)); // late update is dropped
         int temp = *client_id;
-        mailboxes[*client_id]->put(new double(-1.0), 0);
+        control_plane->send(*client_id, ServerMessage::TERMINATE);
         simgrid::s4u::this_actor::execute(0.15 * speed);
         XBT_INFO("Step 5.%04d: Sent termination signal to client %d", temp, temp);
     }
+    checkpointer.drain();
+    validator.drain();
+    report["checkpoint"] = checkpointer.summary();
+    report["validation"] = validator.summary();
+    report["memory"] = server_memory->summary();
+    report["intra_node"] = intra_node->summary();
+    report["population"] = population->summary();
+    report["steps"] = round;
+    report["steps_per_hour"] = round * 3600.0 / simgrid::s4u::Engine::get_clock();
 }
 
 static void client(std::vector<std::string> args)
 {
-    // Create a random device to seed the generator
-    std::random_device rd;
+    xbt_assert(args.size() >= 6, "The client expects at least 6 arguments");
 
-    // Create a Mersenne Twister pseudo-random number generator
-    std::mt19937 gen(rd());
+    // Create a Mersenne Twister pseudo-random number generator, seeded per client by main() so that seeded runs repeat
+    std::mt19937 gen(std::stoul(args[5]));
 
     // Create a uniform_real_distribution to generate floating-point numbers between 1 and 2
     std::normal_distribution<double> dist(1, 0.12);
 
-    xbt_assert(args.size() >= 5, "The client expects at least 5 arguments");
-
     simgrid::s4u::Host *my_host = simgrid::s4u::this_actor::get_host();
 
     int client_id = std::stoi(args[0]);
@@ -112,138 +180,47 @@ static void client(std::vector<std::string> args)
 
     simgrid::s4u::Mailbox *my_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(client_id));
     simgrid::s4u::Mailbox *server_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(client_count));
-
-
-    double *comm_cost = nullptr;
-    comm_cost = my_mailbox->get<double>();
-    double *task_signal = nullptr;
-    do
+    simgrid::s4u::Mailbox *my_control = ControlPlane::mailbox(client_id);
+
+    double comm_cost = 0.0;
+    ServerMessage *task_signal = nullptr;
+    ServerMessage *next_signal = nullptr; // already received by a pipelined exchange
+    double carried_flops = 0.0;           // local training already done on the stale model
+    long round = 0;                       // global round of the model being trained
+    while (true)
     {
-        task_signal = my_mailbox->get<double>();
-        if (*task_signal > 0)
+        task_signal = next_signal ? next_signal : ControlPlane::receive(my_mailbox, my_control);
+        next_signal = nullptr;
+        bool terminate = task_signal->kind == ServerMessage::TERMINATE;
+        if (!terminate)
         {
-            XBT_INFO("Step 2.%04d: Received model", client_id);
+            comm_cost = task_signal->model_size;
+            round = task_signal->round;
         }
-        else
+        delete task_signal;
+        if (terminate)
         {
             XBT_INFO("[Client %d]: Terminating.", client_id);
             // XBT_INFO("Current simulation time: %f seconds", simgrid::s4u::Engine::get_clock());
             break;
         }
+        XBT_INFO("Step 2.%04d: Received model", client_id);
         // XBT_INFO("[Client %d]: Training", client_id);
         if (control == 0)
-            simgrid::s4u::this_actor::execute(training_cost * speed);
+            simgrid::s4u::this_actor::execute(std::max(0.0, training_cost * speed - carried_flops));
         else
-            simgrid::s4u::this_actor::execute(training_cost * speed * dist(gen));
+            simgrid::s4u::this_actor::execute(std::max(0.0, training_cost * speed * dist(gen) - carried_flops));
         // XBT_INFO("[Client %d]: Sending model", client_id);
-        server_mailbox->put(&client_id, *comm_cost * 8); // send local model to server
-        XBT_INFO("Step 3.%04d: Sent model, receiving updated model", client_id);
-
-    } while (*task_signal > 0);
-}
-
-json load_config(const char *config_arg)
-{
-    xbt_assert(config_arg != nullptr, "Missing JSON configuration argument");
-    std::ifstream file(config_arg);
-    if (file.good())
-    {
-        try
-        {
-            return json::parse(file);
-        }
-        catch (const json::parse_error &e)
-        {
-            xbt_die("Failed to parse configuration file %s: %s", config_arg, e.what());
-        }
-    }
-
-    try
-    {
-        return json::parse(config_arg);
-    }
-    catch (const json::parse_error &e)
-    {
-        xbt_die("Failed to parse configuration JSON string: %s", e.what());
-    }
-}
-
-std::unordered_map<int, double> parse_client_effects(const json &rules, int total_clients)
-{
-    std::unordered_map<int, double> effects;
-    if (rules.is_null())
-        return effects;
-
-    xbt_assert(rules.is_array(), "Straggler configuration must be a JSON array");
-
-    for (const auto &rule : rules)
-    {
-        xbt_assert(rule.contains("effect"), "Each straggler rule must define an \"effect\"");
-        double effect = rule["effect"].get<double>();
-        xbt_assert(effect > 0.0, "Straggler effect must be positive (got %f)", effect);
-
-        bool applied = false;
-        auto apply_to_client = [&](int client_id) {
-            xbt_assert(client_id >= 0 && client_id < total_clients, "Invalid straggler client %d (valid range: 0-%d)", client_id, total_clients - 1);
-            applied = true;
-            auto it = effects.find(client_id);
-            if (it == effects.end())
-            {
-                effects[client_id] = effect;
-            }
-            else
-            {
-                it->second *= effect;
-            }
-        };
-
-        if (rule.contains("client"))
-        {
-            xbt_assert(rule["client"].is_number_integer(), "\"client\" must be an integer");
-            apply_to_client(rule["client"].get<int>());
-        }
-
-        if (rule.contains("clients"))
-        {
-            xbt_assert(rule["clients"].is_array(), "\"clients\" must be an array of integers");
-            for (const auto &client_val : rule["clients"])
-            {
-                xbt_assert(client_val.is_number_integer(), "Each entry in \"clients\" must be an integer");
-                apply_to_client(client_val.get<int>());
-            }
-        }
-
-        if (rule.contains("range"))
+        server_memory->reserve(payload->bytes(comm_cost * 8, round, true));
+        intra_node->charge(client_id, payload->bytes(comm_cost * 8, round, true));
+        if (pipeline->enabled)
         {
-            const auto &range_val = rule["range"];
-            int start_client = 0;
-            int end_client = 0;
-            if (range_val.is_array())
-            {
-                xbt_assert(range_val.size() == 2, "\"range\" array must contain exactly two integers");
-                xbt_assert(range_val[0].is_number_integer() && range_val[1].is_number_integer(), "\"range\" entries must be integers");
-                start_client = range_val[0].get<int>();
-                end_client = range_val[1].get<int>();
-            }
-            else
-            {
-                xbt_assert(range_val.is_object(), "\"range\" must be an object or a two-value array");
-                xbt_assert(range_val.contains("start") && range_val.contains("end"), "\"range\" object must contain \"start\" and \"end\"");
-                xbt_assert(range_val["start"].is_number_integer() && range_val["end"].is_number_integer(), "\"start\" and \"end\" must be integers");
-                start_client = range_val["start"].get<int>();
-                end_client = range_val["end"].get<int>();
-            }
-            xbt_assert(start_client <= end_client, "\"range\" start must be <= end");
-            for (int client = start_client; client <= end_client; ++client)
-            {
-                apply_to_client(client);
-            }
+            next_signal = pipeline->exchange(server_mailbox, &client_id, comm_cost * 8, round, my_mailbox, my_control, training_cost * speed, carried_flops);
+            continue;
         }
-
-        xbt_assert(applied, "Straggler rule must target at least one client");
+        payload->put(server_mailbox, &client_id, comm_cost * 8, round, true); // send local model to server
+        XBT_INFO("Step 3.%04d: Sent model, receiving updated model", client_id);
     }
-
-    return effects;
 }
 
 int main(int argc, char *argv[])
@@ -252,9 +229,12 @@ int main(int argc, char *argv[])
 
     simgrid::s4u::Engine e(&argc, argv);
 
-    e.load_platform(argv[1]);
-
     json config = load_config(argv[2]);
+    if (config.contains("network_model"))
+        apply_network_model(config["network_model"]);
+
+    e.load_platform(argv[1]);
+    apply_wifi_rates(e);
 
     // Register server and client functions
     e.register_function("server", &server);
@@ -271,6 +251,15 @@ int main(int argc, char *argv[])
     double training_cost = config.at("training_cost").get<double>();
     double comm_cost = config.at("comm_cost").get<double>();
     int control = config.value("control", 0);
+    json checkpoint_settings = config.value("checkpoint", json::object());
+    double validation_cost = config.value("validation_cost", 0.0);
+    int validation_flag = config.value("validation_flag", 0);
+    long validation_interval = config.value("validation_interval", 1L);
+    std::string validation_mode = config.value("validation_mode", std::string("overlap"));
+    json memory_settings = config.value("memory", json::object());
+    json population_settings = config.value("population", json::object());
+    json intra_node_settings = config.value("intra_node", json::object());
+    unsigned seed = config.contains("seed") ? config["seed"].get<unsigned>() : std::random_device{}();
 
     json straggler_rules = config.contains("stragglers") ? config["stragglers"] : json::array();
     std::unordered_map<int, double> client_effects = parse_client_effects(straggler_rules, nclients);
@@ -285,11 +274,15 @@ int main(int argc, char *argv[])
     // Create the server actor on host "Node-1"
     std::vector<std::string> server_args = {std::to_string(nclients), std::to_string(nepochs),
                                             std::to_string(dataloader_cost), std::to_string(aggregation_cost),
-                                            std::to_string(comm_cost)};
-    simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
+                                            std::to_string(comm_cost), checkpoint_settings.dump(),
+                                            std::to_string(validation_cost), std::to_string(validation_flag),
+                                            std::to_string(validation_interval), validation_mode, memory_settings.dump()};
+    simgrid::s4u::ActorPtr server_actor = simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
 
-    // Distribute clients across multiple nodes
+    // Distribute client slots across multiple nodes
     int client_id = 0;
+    std::vector<simgrid::s4u::Host *> slot_hosts;
+    std::vector<std::vector<std::string>> slot_args;
 
     for (int i = 0; i < nclients_pernode - 1 && client_id < nclients; ++i, ++client_id)
     {
@@ -297,8 +290,9 @@ int main(int argc, char *argv[])
         std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients),
                                                 std::to_string(dataloader_cost * multiplier),
                                                 std::to_string(training_cost * 0.8 * multiplier),
-                                                std::to_string(control)};
-        simgrid::s4u::Actor::create("client", simgrid::s4u::Host::by_name("Node-1"), client, client_args);
+                                                std::to_string(control), std::to_string(seed + client_id)};
+        slot_hosts.push_back(simgrid::s4u::Host::by_name("Node-1"));
+        slot_args.push_back(client_args);
     }
 
     int node_index = 2;
@@ -311,16 +305,73 @@ int main(int argc, char *argv[])
             std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients),
                                                     std::to_string(dataloader_cost * multiplier),
                                                     std::to_string(training_cost * multiplier),
-                                                    std::to_string(control)};
-            simgrid::s4u::Actor::create("client", simgrid::s4u::Host::by_name(node_name), client, client_args);
+                                                    std::to_string(control), std::to_string(seed + client_id)};
+            slot_hosts.push_back(simgrid::s4u::Host::by_name(node_name));
+            slot_args.push_back(client_args);
         }
         ++node_index;
     }
 
+    pipeline = new ClientPipeline(config.value("client_pipeline", std::string("off")));
+    control_plane = new ControlPlane();
+    latency = new LatencyMetrics(config.value("latency", json::object()));
+    payload = new PayloadSchedule(config.value("payload_schedule", json::array()));
+    intra_node = new IntraNodeModel(intra_node_settings, simgrid::s4u::Host::by_name("Node-1"), slot_hosts);
+    if (config.contains("background"))
+    {
+        background = new BackgroundTraffic(config["background"], seed);
+        for (size_t i = 0; i < background->generators.size(); i++)
+        {
+            simgrid::s4u::ActorPtr generator = simgrid::s4u::Actor::create("background_" + std::to_string(i), simgrid::s4u::Host::by_name("Node-1"),
+                                                                           [i]() { background->run(i); });
+            generator->daemonize();
+        }
+    }
+    population = new Population(population_settings, nclients, seed);
+    population->spawn = [slot_hosts, slot_args](int slot) {
+        simgrid::s4u::Actor::create("client", slot_hosts[slot], client, slot_args[slot]);
+    };
+    for (int slot = 0; slot < population->initial; slot++)
+        population->start(slot);
+    if (population->dynamic())
+    {
+        simgrid::s4u::ActorPtr manager = simgrid::s4u::Actor::create("population_manager", simgrid::s4u::Host::by_name("Node-1"), []() { population->run(); });
+        manager->daemonize();
+    }
+
+    timeline = new TimelineChecksum();
+
+    if (config.contains("heartbeat"))
+    {
+        heartbeat = new Heartbeat(config["heartbeat"], nclients * nepochs);
+        simgrid::s4u::Engine::on_time_advance_cb([](double) { heartbeat->tick(); });
+    }
+
     // Run the simulation
-    e.run();
+    if (config.contains("budget"))
+    {
+        budget = new Budget(config["budget"]);
+        budget->run(e, server_actor);
+    }
+    else
+        e.run();
 
     XBT_INFO("Simulation is over");
+    report["simulated_time"] = budget ? budget->end_time() : simgrid::s4u::Engine::get_clock();
+    if (budget)
+    {
+        report["truncated"] = !budget->stopped_by.empty();
+        report["budget"] = budget->summary();
+        report["completed"] = progress;
+    }
+    report["timeline"] = timeline->summary();
+    report["payload_phases"] = payload->summary();
+    report["control_plane"] = control_plane->summary();
+    report["latency"] = latency->summary();
+    if (background)
+        report["background"] = background->summary();
+    report["pipeline"] = pipeline->summary();
+    write_report(config.value("report_file", std::string()));
 
     return 0;
 }
@@ -9,7 +9,16 @@
 *
 */
 
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
 #include <random>
+#include <set>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -19,17 +28,541 @@
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(APPFL, "Messages specific for this example");
 
-using json = nlohmann::json;
+#include "FedCommon.hpp"
+
+// Server CPU time, in seconds at the server's speed, per model sent to a client and per full-width
+// update folded into the average. The simulated server and the shadow predictor both charge them.
+static const double dispatch_overhead = 0.05;
+static const double processing_overhead = 0.17;
+
+/**
+ * @brief QoS classes for transfers: weighted shares of the contended links.
+ *
+ * Every message class ("control", "download", "upload", "checkpoint") and every client has a weight,
+ * and a transfer weighs (class weight x client weight). SimGrid comms have no priorities and their
+ * rate bounds cannot change once started, so a transfer is cut into `chunks` pieces. The leading
+ * pieces go as host-to-host flows and the last one carries the message. Before each piece, the
+ * transfer is bounded on every link of its route to weight / (sum of the weights in flight on the
+ * link) of the link bandwidth, so contending transfers share a link in proportion to their weights.
+ * A transfer alone on its links runs unbounded. Without a "qos" section, transfers go as one
+ * unbounded message. The leading pieces do not wait for the receiver, so QoS also changes when
+ * transfers block: compare QoS runs with each other (e.g. all weights 1), not with runs without it.
+ */
+class QoS
+{
+public:
+    std::map<std::string, double> class_weight;
+    std::unordered_map<int, double> client_weight;
+    std::unordered_map<simgrid::s4u::Link *, double> in_flight; // weight of the transfers on each link
+    simgrid::s4u::Host *server_host;
+    std::vector<simgrid::s4u::Host *> client_hosts;
+    bool enabled;
+    int chunks;
+    long transfers, capped;
+
+    QoS(const json &settings, const std::unordered_map<int, double> &client_weight, simgrid::s4u::Host *server_host,
+        const std::vector<simgrid::s4u::Host *> &client_hosts)
+    {
+        const json classes = settings.value("classes", json::object());
+        for (const char *name : {"control", "download", "upload", "checkpoint"})
+        {
+            class_weight[name] = classes.value(name, 1.0);
+            xbt_assert(class_weight[name] > 0, "QoS weight of class %s must be positive", name);
+        }
+        enabled = !settings.empty();
+        chunks = settings.value("chunks", 8);
+        xbt_assert(chunks >= 1, "QoS \"chunks\" must be at least 1 (got %d)", chunks);
+        this->client_weight = client_weight;
+        this->server_host = server_host;
+        this->client_hosts = client_hosts;
+        transfers = 0;
+        capped = 0;
+    }
+
+    double weight(const std::string &message_class, int client_id) const
+    {
+        auto it = client_weight.find(client_id);
+        return class_weight.at(message_class) * (it == client_weight.end() ? 1.0 : it->second);
+    }
+
+    static std::vector<simgrid::s4u::Link *> links(simgrid::s4u::Host *src, simgrid::s4u::Host *dst)
+    {
+        std::vector<simgrid::s4u::Link *> route;
+        src->route_to(dst, route, nullptr);
+        // A fat pipe does not share its bandwidth and a WIFI link's depends on the station
+        route.erase(std::remove_if(route.begin(), route.end(),
+                                   [](simgrid::s4u::Link *link)
+                                   {
+                                       return link->get_sharing_policy() == simgrid::s4u::Link::SharingPolicy::FATPIPE ||
+                                              link->get_sharing_policy() == simgrid::s4u::Link::SharingPolicy::WIFI || std::isinf(link->get_bandwidth());
+                                   }),
+                    route.end());
+        return route;
+    }
+
+    /**
+     * @brief Bound of a transfer of `weight` on `route` given the weights in flight, which include its
+     * own when `counted`, or -1 when no other transfer shares its links.
+     */
+    double share(const std::vector<simgrid::s4u::Link *> &route, double weight, bool counted)
+    {
+        double bound = std::numeric_limits<double>::infinity();
+        for (simgrid::s4u::Link *link : route)
+        {
+            double total = in_flight[link] + (counted ? 0.0 : weight);
+            if (total > weight * (1.0 + 1e-9))
+                bound = std::min(bound, link->get_bandwidth() * weight / total);
+        }
+        return std::isinf(bound) ? -1.0 : bound;
+    }
+
+    /**
+     * @brief Bound a transfer of `message_class` between `src` and `dst` would get if it started now.
+     * Asynchronous checkpoint writes and failed upload attempts keep it for their whole duration.
+     */
+    double rate(const std::string &message_class, double weight, simgrid::s4u::Host *src, simgrid::s4u::Host *dst)
+    {
+        if (!enabled)
+            return -1.0;
+        return share(links(src, dst), class_weight.at(message_class) * weight, false);
+    }
+
+    /**
+     * @brief Bound of a transfer between the server and `client_id` (towards the server for "upload")
+     * that started now.
+     */
+    double rate(const std::string &message_class, int client_id)
+    {
+        if (!enabled)
+            return -1.0;
+        bool upload = message_class == "upload";
+        simgrid::s4u::Host *client_host = client_hosts[client_id];
+        return share(upload ? links(client_host, server_host) : links(server_host, client_host), weight(message_class, client_id), false);
+    }
+
+    /**
+     * @brief Blocking transfer of `bytes` between the server and `client_id` at the weighted share
+     * of its route.
+     *
+     * @param message_class
+     * @param client_id
+     * @param bytes
+     * @param deliver posts the message with its share of the bytes (the last chunk) and its bound, -1 when unbounded
+     */
+    void transfer(const std::string &message_class, int client_id, double bytes, const std::function<void(double, double)> &deliver)
+    {
+        if (!enabled)
+        {
+            deliver(1.0, -1.0);
+            return;
+        }
+        bool upload = message_class == "upload";
+        simgrid::s4u::Host *src = upload ? client_hosts[client_id] : server_host;
+        simgrid::s4u::Host *dst = upload ? server_host : client_hosts[client_id];
+        std::vector<simgrid::s4u::Link *> route = links(src, dst);
+        double own = weight(message_class, client_id);
+        for (simgrid::s4u::Link *link : route)
+            in_flight[link] += own;
+        int pieces = message_class == "control" ? 1 : chunks; // termination messages are too small to split
+        for (int piece = 1; piece < pieces; piece++)
+        {
+            double bound = share(route, own, true);
+            simgrid::s4u::CommPtr flow = simgrid::s4u::Comm::sendto_init(src, dst)->set_payload_size(static_cast<uint64_t>(bytes / pieces));
+            if (bound > 0)
+            {
+                flow->set_rate(bound);
+                capped++;
+            }
+            flow->start()->wait();
+        }
+        double bound = share(route, own, true);
+        if (bound > 0)
+            capped++;
+        deliver(1.0 / pieces, bound);
+        for (simgrid::s4u::Link *link : route)
+            if ((in_flight[link] -= own) <= 1e-12)
+                in_flight.erase(link);
+        transfers++;
+    }
+
+    json summary() const
+    {
+        return json{{"weights", class_weight}, {"chunks", chunks}, {"transfers", transfers}, {"capped_chunks", capped}};
+    }
+};
+
+/**
+ * @brief Upload coordinator run by the server: clients ask for an upload slot before sending
+ * their local model and hand it back once the transfer is over.
+ *
+ * At most `slots` uploads are in flight (0 lets every client upload at once). When a slot frees
+ * up, the "fifo" policy grants it in request order, "sjf" to the client with the shortest idle
+ * upload time, and "fair" to the client whose host has the fewest uploads in flight, so nodes
+ * share the fabric evenly.
+ */
+class UploadCoordinator
+{
+public:
+    struct Request
+    {
+        int client_id;
+        long order;
+        double request_time;
+    };
+
+    int slots, active, peak_active;
+    std::string policy;
+    long requests;
+    double wait_time, max_wait;
+    std::vector<Request> waiting;
+    std::vector<double> upload_time;
+    std::vector<simgrid::s4u::Host *> client_hosts;
+    std::unordered_map<simgrid::s4u::Host *, int> host_active;
+
+    simgrid::s4u::MutexPtr mutex;
+    simgrid::s4u::ConditionVariablePtr freed;
+
+    UploadCoordinator(const json &settings, simgrid::s4u::Host *server_host, const std::vector<simgrid::s4u::Host *> &client_hosts, double upload_bytes)
+    {
+        slots = settings.value("slots", 0);
+        policy = settings.value("policy", std::string("fifo"));
+        xbt_assert(slots >= 0, "Upload slots must be non-negative (got %d)", slots);
+        xbt_assert(policy == "fifo" || policy == "sjf" || policy == "fair", "Upload policy must be \"fifo\", \"sjf\" or \"fair\" (got %s)", policy.c_str());
+        this->client_hosts = client_hosts;
+        for (simgrid::s4u::Host *client_host : client_hosts)
+            upload_time.push_back(idle_transfer_time(client_host, server_host, upload_bytes));
+        active = 0;
+        peak_active = 0;
+        requests = 0;
+        wait_time = 0.0;
+        max_wait = 0.0;
+        mutex = simgrid::s4u::Mutex::create();
+        freed = simgrid::s4u::ConditionVariable::create();
+    }
+
+    /**
+     * @brief Index in `waiting` of the request the policy serves next.
+     */
+    size_t next() const
+    {
+        size_t best = 0;
+        for (size_t i = 1; i < waiting.size(); i++)
+        {
+            const Request &a = waiting[i], &b = waiting[best];
+            bool better = a.order < b.order;
+            if (policy == "sjf" && upload_time[a.client_id] != upload_time[b.client_id])
+                better = upload_time[a.client_id] < upload_time[b.client_id];
+            else if (policy == "fair")
+            {
+                int load_a = host_active.count(client_hosts[a.client_id]) ? host_active.at(client_hosts[a.client_id]) : 0;
+                int load_b = host_active.count(client_hosts[b.client_id]) ? host_active.at(client_hosts[b.client_id]) : 0;
+                if (load_a != load_b)
+                    better = load_a < load_b;
+            }
+            if (better)
+                best = i;
+        }
+        return best;
+    }
+
+    /**
+     * @brief Called by a client before it uploads; blocks until it holds an upload slot.
+     *
+     * @param client_id
+     */
+    void acquire(int client_id)
+    {
+        double begin = simgrid::s4u::Engine::get_clock();
+        std::unique_lock<simgrid::s4u::Mutex> lock(*mutex);
+        waiting.push_back(Request{client_id, requests++, begin});
+        while (slots > 0 && (active >= slots || waiting[next()].client_id != client_id))
+            freed->wait(lock);
+        waiting.erase(std::find_if(waiting.begin(), waiting.end(), [client_id](const Request &r) { return r.client_id == client_id; }));
+        active++;
+        host_active[client_hosts[client_id]]++;
+        peak_active = std::max(peak_active, active);
+        double waited = simgrid::s4u::Engine::get_clock() - begin;
+        wait_time += waited;
+        max_wait = std::max(max_wait, waited);
+    }
+
+    /**
+     * @brief Called by a client once its upload has reached the server.
+     *
+     * @param client_id
+     */
+    void release(int client_id)
+    {
+        active--;
+        host_active[client_hosts[client_id]]--;
+        freed->notify_all();
+    }
+
+    json summary() const
+    {
+        return json{{"slots", slots}, {"policy", policy}, {"peak_concurrent", peak_active},
+                    {"mean_wait", requests > 0 ? wait_time / requests : 0.0}, {"max_wait", max_wait}};
+    }
+};
+
+/**
+ * @brief Transient upload failures and the clients' retry policy.
+ *
+ * Each upload attempt fails with the client's probability, combined with that of every link on
+ * its route to the server. A failed attempt drops partway through: the bytes sent until then
+ * still load the network, and the client retries after an exponential backoff. With `resume`,
+ * the retry continues from the offset the server acknowledged; otherwise it starts over and the
+ * bytes of the failed attempt are wasted.
+ */
+class UploadFailures
+{
+public:
+    std::vector<double> failure_probability; // per attempt, for each client
+    double backoff, backoff_factor, max_backoff, jitter;
+    bool resume;
+    simgrid::s4u::Host *server_host;
+    std::vector<simgrid::s4u::Host *> client_hosts;
+    std::mt19937 gen;
+    long uploads, retries;
+    int max_attempts;
+    double wasted_bytes, backoff_time;
+
+    UploadFailures(const json &settings, const std::unordered_map<int, double> &client_probability, simgrid::s4u::Host *server_host,
+                   const std::vector<simgrid::s4u::Host *> &client_hosts, unsigned seed)
+        : gen(seed)
+    {
+        double probability = settings.value("probability", 0.0);
+        json link_probability = settings.value("links", json::object());
+        backoff = settings.value("backoff", 1.0);
+        backoff_factor = settings.value("backoff_factor", 2.0);
+        max_backoff = settings.value("max_backoff", 60.0);
+        jitter = settings.value("jitter", 0.0);
+        resume = settings.value("resume", false);
+        xbt_assert(backoff >= 0 && backoff_factor >= 1, "Upload backoff must be non-negative and grow by a factor of at least 1");
+        xbt_assert(jitter >= 0 && jitter <= 1, "Upload backoff jitter must be within [0, 1] (got %f)", jitter);
+
+        for (size_t i = 0; i < client_hosts.size(); i++)
+        {
+            auto it = client_probability.find(i);
+            double success = 1.0 - (it == client_probability.end() ? probability : it->second);
+            std::vector<simgrid::s4u::Link *> links;
+            double latency = 0.0;
+            client_hosts[i]->route_to(server_host, links, &latency);
+            for (simgrid::s4u::Link *link : links)
+                if (link_probability.contains(link->get_name()))
+                    success *= 1.0 - link_probability[link->get_name()].get<double>();
+            xbt_assert(success > 0 && success <= 1, "Uploads of client %zu must have a failure probability within [0, 1)", i);
+            failure_probability.push_back(1.0 - success);
+        }
+        this->server_host = server_host;
+        this->client_hosts = client_hosts;
+        uploads = 0;
+        retries = 0;
+        max_attempts = 0;
+        wasted_bytes = 0.0;
+        backoff_time = 0.0;
+    }
+
+    /**
+     * @brief Play the failed attempts of an upload of `bytes` by `client_id`, up to the attempt
+     * that goes through.
+     *
+     * @param client_id
+     * @param bytes
+     * @param rate bound of the transfer, -1 when unbounded
+     * @return share of the upload left for the successful attempt
+     */
+    double retry(int client_id, double bytes, double rate)
+    {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        double remaining = bytes;
+        double delay = backoff;
+        int attempts = 1;
+        while (uniform(gen) < failure_probability[client_id])
+        {
+            double sent = remaining * uniform(gen); // the connection drops partway through
+            simgrid::s4u::CommPtr attempt = simgrid::s4u::Comm::sendto_init(client_hosts[client_id], server_host);
+            attempt->set_payload_size(static_cast<uint64_t>(sent));
+            if (rate > 0)
+                attempt->set_rate(rate);
+            attempt->start()->wait();
+            if (resume)
+                remaining -= sent;
+            else
+                wasted_bytes += sent;
+            double pause = delay * (1.0 + jitter * (2.0 * uniform(gen) - 1.0));
+            XBT_INFO("[Upload]: client %d failed attempt %d after %f bytes, retrying in %f s", client_id, attempts, sent, pause);
+            simgrid::s4u::this_actor::sleep_for(pause);
+            backoff_time += pause;
+            delay = std::min(delay * backoff_factor, max_backoff);
+            retries++;
+            attempts++;
+        }
+        uploads++;
+        max_attempts = std::max(max_attempts, attempts);
+        return bytes > 0 ? remaining / bytes : 1.0;
+    }
+
+    json summary() const
+    {
+        return json{{"uploads", uploads}, {"retries", retries}, {"max_attempts", max_attempts}, {"wasted_bytes", wasted_bytes},
+                    {"backoff_time", backoff_time}, {"resume", resume}};
+    }
+};
+
+/**
+ * @brief Per-round client selection for partial participation.
+ *
+ * "all" keeps every client in every round and "random" samples `clients_per_round` of them
+ * uniformly. "utility" follows Oort's system utility: it exploits the clients with the shortest
+ * estimated round trip, keeps an `exploration` share of the slots for clients that were never
+ * selected (random ones once all have been), and forces in any client left out for `max_idle`
+ * rounds so that slow clients still contribute.
+ */
+class ClientSelector
+{
+public:
+    std::string policy;
+    int per_round, max_idle;
+    double exploration, momentum;
+    std::vector<double> duration; // estimated round trip of each client, < 0 until observed
+    std::vector<int> participation, idle;
+    std::mt19937 gen;
+
+    ClientSelector(const json &settings, int num_clients, unsigned seed) : gen(seed)
+    {
+        policy = settings.value("policy", std::string("all"));
+        xbt_assert(policy == "all" || policy == "random" || policy == "utility", "Selection policy must be \"all\", \"random\" or \"utility\" (got %s)", policy.c_str());
+        per_round = policy == "all" ? num_clients : settings.value("clients_per_round", num_clients);
+        xbt_assert(per_round > 0 && per_round <= num_clients, "Clients per round must be within 1-%d (got %d)", num_clients, per_round);
+        exploration = settings.value("exploration", 0.1);
+        // by default every client gets a turn at least as often as a round-robin would give it one
+        max_idle = settings.value("max_idle", (num_clients + per_round - 1) / per_round);
+        xbt_assert(max_idle >= 0, "Selection max_idle must be non-negative");
+        momentum = settings.value("momentum", 0.5);
+        xbt_assert(exploration >= 0 && exploration <= 1, "Selection exploration must be within 0-1");
+        duration.assign(num_clients, -1.0);
+        participation.assign(num_clients, 0);
+        idle.assign(num_clients, 0);
+    }
+
+    std::vector<int> select()
+    {
+        int num_clients = static_cast<int>(duration.size());
+        std::vector<int> order(num_clients);
+        std::iota(order.begin(), order.end(), 0);
+        std::vector<int> chosen;
+        if (policy == "all")
+            chosen = order;
+        else if (policy == "random")
+        {
+            std::shuffle(order.begin(), order.end(), gen);
+            chosen.assign(order.begin(), order.begin() + per_round);
+        }
+        else
+        {
+            std::vector<bool> taken(num_clients, false);
+            auto take = [&](int client_id) {
+                if (static_cast<int>(chosen.size()) < per_round && !taken[client_id])
+                {
+                    taken[client_id] = true;
+                    chosen.push_back(client_id);
+                }
+            };
+            // fairness: clients left out for too long come first
+            if (max_idle > 0)
+            {
+                std::vector<int> overdue = order;
+                std::stable_sort(overdue.begin(), overdue.end(), [this](int a, int b) { return idle[a] > idle[b]; });
+                for (int client_id : overdue)
+                    if (idle[client_id] >= max_idle)
+                        take(client_id);
+            }
+            // exploration: unseen clients, or random ones once every client has been seen
+            std::shuffle(order.begin(), order.end(), gen);
+            std::vector<int> unseen;
+            std::copy_if(order.begin(), order.end(), std::back_inserter(unseen), [this](int c) { return duration[c] < 0; });
+            int explore_slots = static_cast<int>(std::lround(exploration * per_round));
+            for (int client_id : unseen.empty() ? order : unseen)
+                if (explore_slots > 0 && !taken[client_id])
+                {
+                    take(client_id);
+                    explore_slots--;
+                }
+            // exploitation: the fastest known clients, then random ones if too few are known
+            std::vector<int> known;
+            std::copy_if(order.begin(), order.end(), std::back_inserter(known), [this](int c) { return duration[c] >= 0; });
+            std::stable_sort(known.begin(), known.end(), [this](int a, int b) { return duration[a] < duration[b]; });
+            for (int client_id : known)
+                take(client_id);
+            for (int client_id : order)
+                take(client_id);
+        }
+        std::vector<bool> selected(num_clients, false);
+        for (int client_id : chosen)
+            selected[client_id] = true;
+        for (int client_id = 0; client_id < num_clients; client_id++)
+        {
+            idle[client_id] = selected[client_id] ? 0 : idle[client_id] + 1;
+            participation[client_id] += selected[client_id];
+        }
+        return chosen;
+    }
+
+    /**
+     * @brief Record the observed round trip (model sent to update received) of a client.
+     *
+     * @param client_id
+     * @param seconds
+     */
+    void observe(int client_id, double seconds)
+    {
+        duration[client_id] = duration[client_id] < 0 ? seconds : (1.0 - momentum) * duration[client_id] + momentum * seconds;
+    }
+
+    json summary() const
+    {
+        double sum = 0.0, sum_squares = 0.0;
+        for (int count : participation)
+        {
+            sum += count;
+            sum_squares += static_cast<double>(count) * count;
+        }
+        return json{{"policy", policy}, {"clients_per_round", per_round}, {"participation", participation},
+                    {"min_participation", *std::min_element(participation.begin(), participation.end())},
+                    {"max_participation", *std::max_element(participation.begin(), participation.end())},
+                    {"jain_fairness", sum_squares > 0 ? sum * sum / (participation.size() * sum_squares) : 1.0}};
+    }
+};
+
+// Created by main() before the actors, used by the server and the clients to bound transfers by QoS class.
+static QoS *qos = nullptr;
+
+// Created by main() when the configuration has an "uploads" section, used by the clients to pace their uploads.
+static UploadCoordinator *uploads = nullptr;
+
+// Created by main() when the configuration has an "upload_failures" section, used by the clients around their uploads.
+static UploadFailures *failures = nullptr;
 
 static void server(std::vector<std::string> args)
 {
-    xbt_assert(args.size() >= 5, "The server function expects at least 5 arguments");
+    xbt_assert(args.size() >= 14, "The server function expects at least 14 arguments");
 
     int client_count = std::stoi(args[0]);
     long epoch_count = std::stol(args[1]);
     double dataloader_cost = std::stod(args[2]);
     double aggregation_cost = std::stod(args[3]);
     double comm_cost = std::stod(args[4]);
+    json checkpoint_settings = json::parse(args[5]);
+    double validation_cost = std::stod(args[6]);
+    bool validation_flag = std::stoi(args[7]);
+    long validation_interval = std::stol(args[8]);
+    std::string validation_mode = args[9];
+    json memory_settings = json::parse(args[10]);
+    json selection_settings = json::parse(args[11]);
+    unsigned seed = std::stoul(args[12]);
+    std::vector<double> payload_share = json::parse(args[13]).get<std::vector<double>>(); // sub-model size of each client
+    bool heterogeneous = *std::min_element(payload_share.begin(), payload_share.end()) < 1.0;
 
     simgrid::s4u::Host *host = simgrid::s4u::this_actor::get_host();
     double speed = host->get_speed();
@@ -43,54 +576,121 @@ static void server(std::vector<std::string> args)
 
     XBT_INFO("Got %d clients and %ld epochs to process", client_count, epoch_count);
 
+    // With an upload coordinator or a server NIC, uploads start as soon as they are posted (or
+    // granted) instead of waiting for the server to reach them, so concurrent uploads really contend
+    // for its ingress
+    simgrid::s4u::Link *server_nic = simgrid::s4u::Link::by_name_or_null(host->get_name() + "-nic_DOWN");
+    if (uploads || server_nic)
+        mailboxes[client_count]->set_receiver(simgrid::s4u::Actor::self());
+
     simgrid::s4u::this_actor::execute(dataloader_cost * speed); // simulate dataload and partitioning
 
-    for (size_t i = 0; i < client_count; i++)
-    {
-        mailboxes[i]->put(new double(comm_cost), 4); // model size
-    }
+    Checkpointer checkpointer(checkpoint_settings, comm_cost);
+    Validator validator(validation_flag, validation_cost, validation_interval, validation_mode);
+    server_memory = new ServerMemory(memory_settings);
+    ClientSelector selector(selection_settings, client_count, seed);
 
+    json round_times = json::array();
+    double upload_phases = 0.0;
+    double ingress_bytes = 0.0; // upload bytes that crossed the server NIC
+    std::vector<double> sent_at(client_count, 0.0);
     for (int round = 0; round < epoch_count; round++)
     {
-        XBT_INFO("[Server]: Starting epoch %d of %ld", round + 1, epoch_count);
-        for (int i = 0; i < client_count; i++)
+        double round_start = simgrid::s4u::Engine::get_clock();
+        double first_arrival = -1.0;
+        std::vector<int> participants = selector.select();
+        payload->round = round;
+        XBT_INFO("[Server]: Starting epoch %d of %ld with %zu clients", round + 1, epoch_count, participants.size());
+        std::set<double> width_shares; // w^2 of each participating width
+        for (int i : participants)
         {
-            mailboxes[i]->put(new double(1), comm_cost * 8);
-            simgrid::s4u::this_actor::execute(0.05 * speed);
+            width_shares.insert(payload_share[i]);
+            intra_node->charge(i, payload->bytes(comm_cost * 8 * payload_share[i], round, false));
+            double begin = simgrid::s4u::Engine::get_clock();
+            qos->transfer("download", i, payload->bytes(comm_cost * 8 * payload_share[i], round, false),
+                          [&](double carried, double rate)
+                          {
+                              payload->put(mailboxes[i], control_plane->model(comm_cost * payload_share[i], round), comm_cost * 8 * payload_share[i], round, false,
+                                           rate, carried, begin);
+                          });
+            sent_at[i] = simgrid::s4u::Engine::get_clock();
+            latency->sent(i);
+            simgrid::s4u::this_actor::execute(dispatch_overhead * speed);
             XBT_INFO("Step 1.%04d: Server sent global model size and model to client %d", i, i);
         }
         int arrival_client_count = 0;
-        while (arrival_client_count < client_count)
+        while (arrival_client_count < static_cast<int>(participants.size()))
         {
             int *client_id = mailboxes[client_count]->get<int>();
-            simgrid::s4u::this_actor::execute(0.17 * speed);
+            if (first_arrival < 0)
+                first_arrival = simgrid::s4u::Engine::get_clock();
+            selector.observe(*client_id, simgrid::s4u::Engine::get_clock() - sent_at[*client_id]);
+            latency->arrived(*client_id);
+            if (intra_node->client_hosts[*client_id] != host)
+                ingress_bytes += payload->bytes(comm_cost * 32 * payload_share[*client_id], round, true);
+            server_memory->spill();
+            simgrid::s4u::this_actor::execute(processing_overhead * payload_share[*client_id] * speed);
+            server_memory->release(payload->bytes(comm_cost * 32 * payload_share[*client_id], round, true)); // local model folded into the running average
             XBT_INFO("Step 4.%04d: received local model from client %d", *client_id, *client_id);
             arrival_client_count++;
         }
+        // HeteroFL averages each parameter over the sub-models that hold it: the region of every
+        // participating width is normalized by its own holder count, one pass per width
+        if (heterogeneous)
+            simgrid::s4u::this_actor::execute(processing_overhead * std::accumulate(width_shares.begin(), width_shares.end(), 0.0) * speed);
+        upload_phases += simgrid::s4u::Engine::get_clock() - first_arrival;
+        round_times.push_back(simgrid::s4u::Engine::get_clock() - round_start);
+        if (checkpointer.storage_host) // a write keeps the share it gets when it starts
+            checkpointer.rate = qos->rate("checkpoint", 1.0, host, checkpointer.storage_host);
+        checkpointer.step(round + 1);
+        validator.step(round + 1);
+        progress = round + 1;
     }
+    for (int i = 0; i < client_count; i++)
+        qos->transfer("control", i, 0.0, [&](double, double rate) { control_plane->send(i, ServerMessage::TERMINATE, rate); });
+    checkpointer.drain();
+    validator.drain();
+    report["checkpoint"] = checkpointer.summary();
+    report["validation"] = validator.summary();
+    report["memory"] = server_memory->summary();
+    report["intra_node"] = intra_node->summary();
+    if (uploads)
+        report["uploads"] = uploads->summary();
+    if (failures)
+        report["upload_failures"] = failures->summary();
+    report["steps"] = epoch_count;
+    report["steps_per_hour"] = epoch_count * 3600.0 / simgrid::s4u::Engine::get_clock();
+    report["round_times"] = round_times;
+    report["selection"] = selector.summary();
+
+    // Incast at the server: time from the first to the last upload of a round, against the time the
+    // server NIC needs to take in the remote uploads of a round back to back
+    json incast{{"mean_upload_phase", epoch_count > 0 ? upload_phases / epoch_count : 0.0}};
+    if (server_nic)
+    {
+        incast["server_nic_bandwidth"] = server_nic->get_bandwidth();
+        incast["ingress_bound"] = epoch_count > 0 ? ingress_bytes / epoch_count / server_nic->get_bandwidth() : 0.0;
+    }
+    report["incast"] = incast;
 }
 
 static void client(std::vector<std::string> args)
 {
-    // Create a random device to seed the generator
-    std::random_device rd;
+    xbt_assert(args.size() >= 6, "The client expects at least 6 arguments");
 
-    // Create a Mersenne Twister pseudo-random number generator
-    std::mt19937 gen(rd());
+    // Create a Mersenne Twister pseudo-random number generator, seeded per client by main() so that seeded runs repeat
+    std::mt19937 gen(std::stoul(args[5]));
 
     // Create a uniform_real_distribution to generate floating-point numbers between 1 and 2
     std::normal_distribution<double> dist(0, 0.12);
 
-    xbt_assert(args.size() >= 5, "The client expects at least 5 argument");
-
     simgrid::s4u::Host *my_host = simgrid::s4u::this_actor::get_host();
 
     int client_id = std::stoi(args[0]);
     int client_count = std::stoi(args[1]);
-    int num_epochs = std::stoi(args[2]);
-    double dataloader_cost = std::stod(args[3]);
-    double training_cost = std::stod(args[4]);
-    int control = std::stoi(args[5]);
+    double dataloader_cost = std::stod(args[2]);
+    double training_cost = std::stod(args[3]);
+    int control = std::stoi(args[4]);
 
     simgrid::s4u::Host *host = simgrid::s4u::this_actor::get_host();
     double speed = host->get_speed();
@@ -101,125 +701,217 @@ static void client(std::vector<std::string> args)
 
     simgrid::s4u::Mailbox *my_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(client_id));        // wait for data
     simgrid::s4u::Mailbox *server_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(client_count)); // wait for data
+    simgrid::s4u::Mailbox *my_control = ControlPlane::mailbox(client_id);
 
-    double *comm_cost = nullptr;
-    comm_cost = my_mailbox->get<double>();
-    for (int i = 0; i < num_epochs + 1; i++)
+    while (true)
     {
-        my_mailbox->get<double>();
-        XBT_INFO("Step 2.%04d: Client %04d Received global model from server (%f bytes)", client_id, client_id, *comm_cost);
+        ServerMessage *signal = ControlPlane::receive(my_mailbox, my_control);
+        bool terminate = signal->kind == ServerMessage::TERMINATE;
+        double comm_cost = signal->model_size;
+        long round = signal->round;
+        delete signal;
+        if (terminate)
+            break;
+        XBT_INFO("Step 2.%04d: Client %04d Received global model from server (%f bytes)", client_id, client_id, comm_cost);
         if (control == 0)
             simgrid::s4u::this_actor::execute(training_cost * speed);
         else
             simgrid::s4u::this_actor::execute(training_cost * speed * dist(gen));
-        server_mailbox->put(&client_id, *comm_cost * 32); // send local model to server
-        XBT_INFO("Step 3.%04d: Client %04d sent updated model to server (%f bytes)", client_id, client_id, *comm_cost);
+        server_memory->reserve(payload->bytes(comm_cost * 32, round, true));
+        intra_node->charge(client_id, payload->bytes(comm_cost * 32, round, true));
+        if (uploads)
+            uploads->acquire(client_id);
+        double share = failures ? failures->retry(client_id, payload->bytes(comm_cost * 32, round, true), qos->rate("upload", client_id)) : 1.0;
+        double begin = simgrid::s4u::Engine::get_clock();
+        // send local model to server
+        qos->transfer("upload", client_id, payload->bytes(comm_cost * 32 * share, round, true),
+                      [&](double carried, double rate) { payload->put(server_mailbox, &client_id, comm_cost * 32 * share, round, true, rate, carried, begin); });
+        if (uploads)
+            uploads->release(client_id);
+        XBT_INFO("Step 3.%04d: Client %04d sent updated model to server (%f bytes)", client_id, client_id, comm_cost);
     }
 }
 
-json load_config(const char *config_arg)
+/**
+ * @brief Shadow-mode predictor: follows the progress events of a live FedAvg round and predicts
+ * when the round completes.
+ *
+ * Rather than re-simulating the round, it uses the analytic fast tier. Per-client finish estimates
+ * live in an ordered multiset and are updated incrementally, so each prediction costs O(log n).
+ * Like the simulated server, the predictor sends the model to the participants one after the other,
+ * so a client's download starts once the earlier ones are done. Transfers are sized by the client's
+ * model width and the payload schedule of the round. Events are read line by line from a file or a pipe:
+ *   round <time> [client ...]           a new round started with these participants, in dispatch order (default: all)
+ *   finish <time> <client> [seconds]    the client's update arrived, optionally with its observed training time
+ *   speed <client> <seconds>            observed training time of a client
+ */
+class ShadowPredictor
 {
-    xbt_assert(config_arg != nullptr, "Missing JSON configuration argument");
-    std::ifstream file(config_arg);
-    if (file.good())
+public:
+    std::vector<double> train_time, share, download_latency, download_bandwidth, upload_latency, upload_bandwidth, received_at;
+    std::vector<bool> participating, finished;
+    std::vector<std::multiset<double>::iterator> handles;
+    std::multiset<double> estimates; // when the server is done with each pending update
+    double download_bytes, upload_bytes, last_event, pending_processing, normalization, momentum;
+    long round, rounds_started; // round of the estimates; `round` events seen so far
+    int pending;
+
+    ShadowPredictor(const std::vector<double> &train_time, const std::vector<double> &share, const std::vector<simgrid::s4u::Host *> &client_hosts,
+                    simgrid::s4u::Host *server_host, double download_bytes, double upload_bytes, double momentum)
     {
-        try
-        {
-            return json::parse(file);
-        }
-        catch (const json::parse_error &e)
+        this->train_time = train_time;
+        this->share = share;
+        for (simgrid::s4u::Host *client_host : client_hosts)
         {
-            xbt_die("Failed to parse configuration file %s: %s", config_arg, e.what());
+            double latency = 0.0;
+            download_bandwidth.push_back(bottleneck_bandwidth(server_host, client_host, &latency));
+            download_latency.push_back(latency);
+            upload_bandwidth.push_back(bottleneck_bandwidth(client_host, server_host, &latency));
+            upload_latency.push_back(latency);
         }
+        this->download_bytes = download_bytes;
+        this->upload_bytes = upload_bytes;
+        this->momentum = momentum;
+        received_at.assign(train_time.size(), 0.0);
+        handles.resize(train_time.size());
+        rounds_started = 0;
+        std::vector<int> everyone(train_time.size());
+        std::iota(everyone.begin(), everyone.end(), 0);
+        start_round(0, 0.0, everyone);
     }
 
-    try
+    double download_time(int client_id) const
     {
-        return json::parse(config_arg);
+        return transfer_time(download_latency[client_id], download_bandwidth[client_id], payload->bytes(download_bytes * share[client_id], round, false));
     }
-    catch (const json::parse_error &e)
+
+    double upload_time(int client_id) const
     {
-        xbt_die("Failed to parse configuration JSON string: %s", e.what());
+        return transfer_time(upload_latency[client_id], upload_bandwidth[client_id], payload->bytes(upload_bytes * share[client_id], round, true));
     }
-}
 
-std::unordered_map<int, double> parse_client_effects(const json &rules, int total_clients)
-{
-    std::unordered_map<int, double> effects;
-    if (rules.is_null())
-        return effects;
-
-    xbt_assert(rules.is_array(), "Straggler configuration must be a JSON array");
+    double processing(int client_id) const { return processing_overhead * share[client_id]; }
 
-    for (const auto &rule : rules)
+    double estimate(int client_id) const
     {
-        xbt_assert(rule.contains("effect"), "Each straggler rule must define an \"effect\"");
-        double effect = rule["effect"].get<double>();
-        xbt_assert(effect > 0.0, "Straggler effect must be positive (got %f)", effect);
-
-        bool applied = false;
-        auto apply_to_client = [&](int client_id) {
-            xbt_assert(client_id >= 0 && client_id < total_clients, "Invalid straggler client %d (valid range: 0-%d)", client_id, total_clients - 1);
-            applied = true;
-            auto it = effects.find(client_id);
-            if (it == effects.end())
-            {
-                effects[client_id] = effect;
-            }
-            else
-            {
-                it->second *= effect;
-            }
-        };
+        return received_at[client_id] + train_time[client_id] + upload_time(client_id) + processing(client_id);
+    }
 
-        if (rule.contains("client"))
+    void start_round(long round, double time, const std::vector<int> &participants)
+    {
+        this->round = round;
+        last_event = time;
+        estimates.clear();
+        participating.assign(train_time.size(), false);
+        finished.assign(train_time.size(), false);
+        pending_processing = 0.0;
+        std::set<double> width_shares;
+        double dispatched = time; // the server's blocking puts go out one after the other
+        for (int client_id : participants)
         {
-            xbt_assert(rule["client"].is_number_integer(), "\"client\" must be an integer");
-            apply_to_client(rule["client"].get<int>());
+            dispatched += download_time(client_id);
+            received_at[client_id] = dispatched;
+            dispatched += dispatch_overhead;
+            participating[client_id] = true;
+            handles[client_id] = estimates.insert(estimate(client_id));
+            pending_processing += processing(client_id);
+            width_shares.insert(share[client_id]);
         }
+        bool heterogeneous = *std::min_element(share.begin(), share.end()) < 1.0;
+        normalization = heterogeneous ? processing_overhead * std::accumulate(width_shares.begin(), width_shares.end(), 0.0) : 0.0;
+        pending = static_cast<int>(estimates.size());
+    }
+
+    void observe_speed(int client_id, double seconds)
+    {
+        train_time[client_id] = (1.0 - momentum) * train_time[client_id] + momentum * seconds;
+        if (!participating[client_id] || finished[client_id])
+            return;
+        estimates.erase(handles[client_id]);
+        handles[client_id] = estimates.insert(estimate(client_id));
+    }
+
+    void finish(int client_id, double time)
+    {
+        last_event = std::max(last_event, time);
+        if (!participating[client_id] || finished[client_id])
+            return;
+        finished[client_id] = true;
+        estimates.erase(handles[client_id]);
+        pending_processing -= processing(client_id);
+        pending--;
+    }
+
+    /**
+     * @brief Predicted completion: the server done with the last expected arrival, but no earlier
+     * than it can process the pending updates one by one, plus the HeteroFL normalization.
+     */
+    double predict() const
+    {
+        double last_done = estimates.empty() ? last_event : std::max(last_event, *estimates.rbegin());
+        return std::max(last_done, last_event + pending_processing) + normalization;
+    }
 
-        if (rule.contains("clients"))
+    void follow(const std::string &events_path, std::ostream &out)
+    {
+        std::ifstream events(events_path);
+        xbt_assert(events.good(), "Cannot open shadow event stream %s", events_path.c_str());
+        std::string line;
+        while (std::getline(events, line))
         {
-            xbt_assert(rule["clients"].is_array(), "\"clients\" must be an array of integers");
-            for (const auto &client_val : rule["clients"])
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind) || kind[0] == '#')
+                continue;
+            auto begin = std::chrono::steady_clock::now();
+            double time = last_event;
+            if (kind == "round")
             {
-                xbt_assert(client_val.is_number_integer(), "Each entry in \"clients\" must be an integer");
-                apply_to_client(client_val.get<int>());
+                fields >> time;
+                std::vector<int> participants;
+                int client_id = -1;
+                while (fields >> client_id)
+                {
+                    xbt_assert(client_id >= 0 && client_id < static_cast<int>(train_time.size()), "Invalid client in shadow event: %s", line.c_str());
+                    participants.push_back(client_id);
+                }
+                if (participants.empty())
+                {
+                    participants.resize(train_time.size());
+                    std::iota(participants.begin(), participants.end(), 0);
+                }
+                start_round(rounds_started++, time, participants);
             }
-        }
-
-        if (rule.contains("range"))
-        {
-            const auto &range_val = rule["range"];
-            int start_client = 0;
-            int end_client = 0;
-            if (range_val.is_array())
+            else if (kind == "finish")
             {
-                xbt_assert(range_val.size() == 2, "\"range\" array must contain exactly two integers");
-                xbt_assert(range_val[0].is_number_integer() && range_val[1].is_number_integer(), "\"range\" entries must be integers");
-                start_client = range_val[0].get<int>();
-                end_client = range_val[1].get<int>();
+                int client_id = -1;
+                double seconds = -1.0;
+                fields >> time >> client_id >> seconds;
+                xbt_assert(client_id >= 0 && client_id < static_cast<int>(train_time.size()), "Invalid client in shadow event: %s", line.c_str());
+                if (seconds > 0)
+                    observe_speed(client_id, seconds);
+                finish(client_id, time);
             }
-            else
+            else if (kind == "speed")
             {
-                xbt_assert(range_val.is_object(), "\"range\" must be an object or a two-value array");
-                xbt_assert(range_val.contains("start") && range_val.contains("end"), "\"range\" object must contain \"start\" and \"end\"");
-                xbt_assert(range_val["start"].is_number_integer() && range_val["end"].is_number_integer(), "\"start\" and \"end\" must be integers");
-                start_client = range_val["start"].get<int>();
-                end_client = range_val["end"].get<int>();
+                int client_id = -1;
+                double seconds = -1.0;
+                fields >> client_id >> seconds;
+                xbt_assert(client_id >= 0 && client_id < static_cast<int>(train_time.size()) && seconds > 0, "Invalid shadow event: %s", line.c_str());
+                observe_speed(client_id, seconds);
             }
-            xbt_assert(start_client <= end_client, "\"range\" start must be <= end");
-            for (int client = start_client; client <= end_client; ++client)
+            else
             {
-                apply_to_client(client);
+                XBT_WARN("Ignoring unknown shadow event: %s", line.c_str());
+                continue;
             }
+            double prediction = predict();
+            double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+            // <event time> <predicted round completion> <pending clients> <prediction cost in us>
+            out << time << " " << prediction << " " << pending << " " << micros << std::endl;
         }
-
-        xbt_assert(applied, "Straggler rule must target at least one client");
     }
-
-    return effects;
-}
+};
 
 int main(int argc, char *argv[])
 {
@@ -227,9 +919,12 @@ int main(int argc, char *argv[])
 
     simgrid::s4u::Engine e(&argc, argv);
 
-    e.load_platform(argv[1]);
-
     json config = load_config(argv[2]);
+    if (config.contains("network_model"))
+        apply_network_model(config["network_model"]);
+
+    e.load_platform(argv[1]);
+    apply_wifi_rates(e);
 
     // Register server and client functions
     e.register_function("server", &server);
@@ -246,6 +941,14 @@ int main(int argc, char *argv[])
     double aggregation_cost = config.at("aggregation_cost").get<double>();
     double training_cost = config.at("training_cost").get<double>();
     double comm_cost = config.at("comm_cost").get<double>();
+    json checkpoint_settings = config.value("checkpoint", json::object());
+    double validation_cost = config.value("validation_cost", 0.0);
+    int validation_flag = config.value("validation_flag", 0);
+    long validation_interval = config.value("validation_interval", 1L);
+    std::string validation_mode = config.value("validation_mode", std::string("overlap"));
+    json memory_settings = config.value("memory", json::object());
+    json intra_node_settings = config.value("intra_node", json::object());
+    unsigned seed = config.contains("seed") ? config["seed"].get<unsigned>() : std::random_device{}();
 
     json straggler_rules = config.contains("stragglers") ? config["stragglers"] : json::array();
     std::unordered_map<int, double> client_effects = parse_client_effects(straggler_rules, nclients);
@@ -257,22 +960,38 @@ int main(int argc, char *argv[])
         return it->second;
     };
 
-    // Create the server actor on host "Node-1"
-    std::vector<std::string> server_args = {std::to_string(nclients), std::to_string(nepochs),
-                                            std::to_string(dataloader_cost), std::to_string(aggregation_cost),
-                                            std::to_string(comm_cost)};
-    simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
+    // HeteroFL-style sub-models: payload and training FLOPs scale with the square of the width
+    json width_rules = config.contains("model_widths") ? config["model_widths"] : json::array();
+    std::unordered_map<int, double> client_widths = parse_client_effects(width_rules, nclients, "width");
+    json width_counts = json::object();
+    auto client_share = [&](int client_id) -> double {
+        auto it = client_widths.find(client_id);
+        double width = it == client_widths.end() ? 1.0 : it->second;
+        xbt_assert(width <= 1.0, "Model width of client %d must be within (0, 1] (got %f)", client_id, width);
+        std::string key = json(width).dump();
+        width_counts[key] = width_counts.value(key, 0) + 1;
+        return width * width;
+    };
+    std::vector<double> payload_shares;
 
     // Distribute clients across multiple nodes
     int client_id = 0;
+    std::vector<simgrid::s4u::Host *> client_hosts;
+    std::vector<std::vector<std::string>> client_args_list;
+    std::vector<double> client_training_costs;
 
     for (int i = 0; i < nclients_pernode - 1 && client_id < nclients; ++i, ++client_id)
     {
         double multiplier = client_multiplier(client_id);
         double node_dataloader_cost = dataloader_cost * multiplier;
-        double node_training_cost = training_cost * 0.8 * multiplier;
-        std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients), std::to_string(nepochs), std::to_string(node_dataloader_cost), std::to_string(node_training_cost), std::to_string(control)};
-        simgrid::s4u::Actor::create("client", simgrid::s4u::Host::by_name("Node-1"), client, client_args);
+        double share = client_share(client_id);
+        double node_training_cost = training_cost * 0.8 * multiplier * share;
+        payload_shares.push_back(share);
+        std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients), std::to_string(node_dataloader_cost), std::to_string(node_training_cost), std::to_string(control),
+                                                std::to_string(seed + client_id)};
+        client_hosts.push_back(simgrid::s4u::Host::by_name("Node-1"));
+        client_args_list.push_back(client_args);
+        client_training_costs.push_back(node_training_cost);
     }
 
     int node_index = 2;
@@ -283,17 +1002,107 @@ int main(int argc, char *argv[])
         {
             double multiplier = client_multiplier(client_id);
             double node_dataloader_cost = dataloader_cost * multiplier;
-            double node_training_cost = training_cost * multiplier;
-            std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients), std::to_string(nepochs), std::to_string(node_dataloader_cost), std::to_string(node_training_cost), std::to_string(control)};
-            simgrid::s4u::Actor::create("client", simgrid::s4u::Host::by_name(node_name), client, client_args);
+            double share = client_share(client_id);
+            double node_training_cost = training_cost * multiplier * share;
+            payload_shares.push_back(share);
+            std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(nclients), std::to_string(node_dataloader_cost), std::to_string(node_training_cost), std::to_string(control),
+                                                    std::to_string(seed + client_id)};
+            client_hosts.push_back(simgrid::s4u::Host::by_name(node_name));
+            client_args_list.push_back(client_args);
+            client_training_costs.push_back(node_training_cost);
         }
         ++node_index;
     }
 
+    payload = new PayloadSchedule(config.value("payload_schedule", json::array()));
+
+    // Shadow mode: predict a live round from its progress events instead of simulating the run
+    if (config.contains("shadow"))
+    {
+        const json &shadow = config["shadow"];
+        ShadowPredictor predictor(client_training_costs, payload_shares, client_hosts, simgrid::s4u::Host::by_name("Node-1"), comm_cost * 8,
+                                  comm_cost * 32, shadow.value("momentum", 0.5));
+        std::string output_path = shadow.value("output", std::string());
+        std::ofstream output;
+        if (!output_path.empty())
+            output.open(output_path);
+        predictor.follow(shadow.at("events").get<std::string>(), output_path.empty() ? std::cout : output);
+        return 0;
+    }
+
+    if (!client_widths.empty())
+        report["model_widths"] = width_counts;
+    control_plane = new ControlPlane();
+    latency = new LatencyMetrics(config.value("latency", json::object()));
+    intra_node = new IntraNodeModel(intra_node_settings, simgrid::s4u::Host::by_name("Node-1"), client_hosts);
+    if (config.contains("background"))
+    {
+        background = new BackgroundTraffic(config["background"], seed);
+        for (size_t i = 0; i < background->generators.size(); i++)
+        {
+            simgrid::s4u::ActorPtr generator = simgrid::s4u::Actor::create("background_" + std::to_string(i), simgrid::s4u::Host::by_name("Node-1"),
+                                                                           [i]() { background->run(i); });
+            generator->daemonize();
+        }
+    }
+    json qos_settings = config.value("qos", json::object());
+    qos = new QoS(qos_settings, parse_client_effects(qos_settings.value("clients", json::array()), nclients, "weight"),
+                  simgrid::s4u::Host::by_name("Node-1"), client_hosts);
+    if (config.contains("uploads"))
+        uploads = new UploadCoordinator(config["uploads"], simgrid::s4u::Host::by_name("Node-1"), client_hosts, comm_cost * 32);
+    if (config.contains("upload_failures"))
+    {
+        const json &failure_settings = config["upload_failures"];
+        failures = new UploadFailures(failure_settings, parse_client_effects(failure_settings.value("clients", json::array()), nclients, "probability"),
+                                      simgrid::s4u::Host::by_name("Node-1"), client_hosts, seed);
+    }
+
+    // Create the server actor on host "Node-1"
+    std::vector<std::string> server_args = {std::to_string(nclients), std::to_string(nepochs),
+                                            std::to_string(dataloader_cost), std::to_string(aggregation_cost),
+                                            std::to_string(comm_cost), checkpoint_settings.dump(),
+                                            std::to_string(validation_cost), std::to_string(validation_flag),
+                                            std::to_string(validation_interval), validation_mode, memory_settings.dump(),
+                                            config.value("selection", json::object()).dump(), std::to_string(seed), json(payload_shares).dump()};
+    simgrid::s4u::ActorPtr server_actor = simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
+
+    for (size_t i = 0; i < client_hosts.size(); i++)
+        simgrid::s4u::Actor::create("client", client_hosts[i], client, client_args_list[i]);
+
+    timeline = new TimelineChecksum();
+
+    if (config.contains("heartbeat"))
+    {
+        heartbeat = new Heartbeat(config["heartbeat"], nepochs);
+        simgrid::s4u::Engine::on_time_advance_cb([](double) { heartbeat->tick(); });
+    }
+
     // Run the simulation
-    e.run();
+    if (config.contains("budget"))
+    {
+        budget = new Budget(config["budget"]);
+        budget->run(e, server_actor);
+    }
+    else
+        e.run();
 
     XBT_INFO("Simulation is over");
+    report["simulated_time"] = budget ? budget->end_time() : simgrid::s4u::Engine::get_clock();
+    if (budget)
+    {
+        report["truncated"] = !budget->stopped_by.empty();
+        report["budget"] = budget->summary();
+        report["completed"] = progress;
+    }
+    report["timeline"] = timeline->summary();
+    report["payload_phases"] = payload->summary();
+    report["control_plane"] = control_plane->summary();
+    report["latency"] = latency->summary();
+    if (config.contains("qos"))
+        report["qos"] = qos->summary();
+    if (background)
+        report["background"] = background->summary();
+    write_report(config.value("report_file", std::string()));
 
     return 0;
 }
@@ -0,0 +1,1664 @@
+/*
+* Copyright (c) 2025, University of California, Merced. All rights reserved.
+*
+* This file is part of the simulation software package developed by
+* the team members of Prof. Xiaoyi Lu's group at University of California, Merced.
+*
+* For detailed copyright and licensing information, please refer to the license
+* file LICENSE in the top level directory.
+*
+*/
+
+// Helpers shared by FedAvg, FedAsync and FedCompass. Each program includes this header once, after
+// declaring its default XBT log category, which the helpers log to.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <simgrid/s4u.hpp>
+#include <unistd.h>
+#include "../../third_party/nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+// Summary of the run, filled in by the actors and written out by main() once the simulation is over.
+static json report;
+
+void write_report(const std::string &path)
+{
+    XBT_INFO("Report: %s", report.dump().c_str());
+    if (path.empty())
+        return;
+    std::ofstream out(path);
+    xbt_assert(out.good(), "Cannot open report file %s", path.c_str());
+    out << report.dump(4) << std::endl;
+}
+
+json load_config(const char *config_arg)
+{
+    xbt_assert(config_arg != nullptr, "Missing JSON configuration argument");
+    std::ifstream file(config_arg);
+    if (file.good())
+    {
+        try
+        {
+            return json::parse(file);
+        }
+        catch (const json::parse_error &e)
+        {
+            xbt_die("Failed to parse configuration file %s: %s", config_arg, e.what());
+        }
+    }
+
+    try
+    {
+        return json::parse(config_arg);
+    }
+    catch (const json::parse_error &e)
+    {
+        xbt_die("Failed to parse configuration JSON string: %s", e.what());
+    }
+}
+
+/**
+ * @brief Per-client values from rules targeting a client, a list or a range; overlapping rules multiply.
+ *
+ * @param rules JSON array of rules (e.g. "stragglers")
+ * @param total_clients
+ * @param key field holding the value of each rule
+ */
+std::unordered_map<int, double> parse_client_effects(const json &rules, int total_clients, const std::string &key = "effect")
+{
+    std::unordered_map<int, double> effects;
+    if (rules.is_null())
+        return effects;
+
+    xbt_assert(rules.is_array(), "Client rules (e.g. stragglers) must be a JSON array");
+
+    for (const auto &rule : rules)
+    {
+        xbt_assert(rule.contains(key), "Each client rule must define a \"%s\"", key.c_str());
+        double effect = rule[key].get<double>();
+        xbt_assert(effect > 0.0, "Client rule \"%s\" must be positive (got %f)", key.c_str(), effect);
+
+        bool applied = false;
+        auto apply_to_client = [&](int client_id) {
+            xbt_assert(client_id >= 0 && client_id < total_clients, "Invalid client %d in rule (valid range: 0-%d)", client_id, total_clients - 1);
+            applied = true;
+            auto it = effects.find(client_id);
+            if (it == effects.end())
+            {
+                effects[client_id] = effect;
+            }
+            else
+            {
+                it->second *= effect;
+            }
+        };
+
+        if (rule.contains("client"))
+        {
+            xbt_assert(rule["client"].is_number_integer(), "\"client\" must be an integer");
+            apply_to_client(rule["client"].get<int>());
+        }
+
+        if (rule.contains("clients"))
+        {
+            xbt_assert(rule["clients"].is_array(), "\"clients\" must be an array of integers");
+            for (const auto &client_val : rule["clients"])
+            {
+                xbt_assert(client_val.is_number_integer(), "Each entry in \"clients\" must be an integer");
+                apply_to_client(client_val.get<int>());
+            }
+        }
+
+        if (rule.contains("range"))
+        {
+            const auto &range_val = rule["range"];
+            int start_client = 0;
+            int end_client = 0;
+            if (range_val.is_array())
+            {
+                xbt_assert(range_val.size() == 2, "\"range\" array must contain exactly two integers");
+                xbt_assert(range_val[0].is_number_integer() && range_val[1].is_number_integer(), "\"range\" entries must be integers");
+                start_client = range_val[0].get<int>();
+                end_client = range_val[1].get<int>();
+            }
+            else
+            {
+                xbt_assert(range_val.is_object(), "\"range\" must be an object or a two-value array");
+                xbt_assert(range_val.contains("start") && range_val.contains("end"), "\"range\" object must contain \"start\" and \"end\"");
+                xbt_assert(range_val["start"].is_number_integer() && range_val["end"].is_number_integer(), "\"start\" and \"end\" must be integers");
+                start_client = range_val["start"].get<int>();
+                end_client = range_val["end"].get<int>();
+            }
+            xbt_assert(start_client <= end_client, "\"range\" start must be <= end");
+            for (int client = start_client; client <= end_client; ++client)
+            {
+                apply_to_client(client);
+            }
+        }
+
+        xbt_assert(applied, "Client rule must target at least one client");
+    }
+
+    return effects;
+}
+
+/**
+ * @brief Apply the calibrated network model (see simulation/network/calibrate_network_model.py).
+ * SimGrid only honors these options when they are set before the platform is loaded.
+ *
+ * @param model "network_model" section of the configuration
+ */
+void apply_network_model(const json &model)
+{
+    static const std::vector<std::pair<std::string, std::string>> options = {
+        {"latency_factor", "network/latency-factor"}, {"bandwidth_factor", "network/bandwidth-factor"}, {"tcp_gamma", "network/TCP-gamma"}};
+    for (const auto &[key, option] : options)
+    {
+        if (!model.contains(key))
+            continue;
+        // piecewise factors are strings such as "0:3.99;65536:3.95"
+        std::string value = model[key].is_string() ? model[key].get<std::string>() : model[key].dump();
+        simgrid::s4u::Engine::set_config(option + ":" + value);
+        XBT_INFO("[Network]: %s set to %s", option.c_str(), value.c_str());
+    }
+}
+
+/**
+ * @brief Set the rate level of every wireless station on its cell's WIFI link. The platform
+ * generator tags the hosts of a wireless cell with "wifi_link" and "wifi_rate" properties.
+ *
+ * @param e
+ */
+void apply_wifi_rates(const simgrid::s4u::Engine &e)
+{
+    for (simgrid::s4u::Host *host : e.get_all_hosts())
+    {
+        const char *link = host->get_property("wifi_link");
+        if (link == nullptr)
+            continue;
+        const char *level = host->get_property("wifi_rate");
+        simgrid::s4u::Link::by_name(link)->set_host_wifi_rate(host, level ? std::stoi(level) : 0);
+    }
+}
+
+/**
+ * @brief Bandwidth of the slowest link on the route from `src` to `dst` (infinite for a local route).
+ *
+ * @param src
+ * @param dst
+ * @param latency set to the latency of the route when not null
+ */
+double bottleneck_bandwidth(simgrid::s4u::Host *src, simgrid::s4u::Host *dst, double *latency = nullptr)
+{
+    std::vector<simgrid::s4u::Link *> links;
+    double route_latency = 0.0;
+    src->route_to(dst, links, &route_latency);
+    double bandwidth = std::numeric_limits<double>::infinity();
+    for (simgrid::s4u::Link *link : links)
+        bandwidth = std::min(bandwidth, link->get_bandwidth());
+    if (latency)
+        *latency = route_latency;
+    return bandwidth;
+}
+
+/**
+ * @brief Transfer time of `bytes` over an idle route of `latency` whose bottleneck link has `bandwidth`.
+ */
+double transfer_time(double latency, double bandwidth, double bytes)
+{
+    return latency + (std::isinf(bandwidth) ? 0.0 : bytes / bandwidth);
+}
+
+/**
+ * @brief Transfer time of `bytes` from `src` to `dst` on an idle network: route latency plus
+ * the bytes over the bottleneck link bandwidth.
+ */
+double idle_transfer_time(simgrid::s4u::Host *src, simgrid::s4u::Host *dst, double bytes)
+{
+    double latency = 0.0;
+    double bandwidth = bottleneck_bandwidth(src, dst, &latency);
+    return transfer_time(latency, bandwidth, bytes);
+}
+
+/**
+ * @brief Blocking put, bounded to `rate` when it is positive.
+ */
+void put_bounded(simgrid::s4u::Mailbox *mailbox, void *payload, double bytes, double rate)
+{
+    if (rate > 0)
+        mailbox->put_init(payload, static_cast<uint64_t>(bytes))->set_rate(rate)->wait();
+    else
+        mailbox->put(payload, static_cast<uint64_t>(bytes));
+}
+
+/**
+ * @brief Periodically persist the global model, either to a disk attached to the server host
+ * or to a remote storage host.
+ *
+ * In "sync" mode the server blocks until the write completes. In "async" mode the write overlaps
+ * with training, and the server only stalls when the previous checkpoint is still in flight.
+ */
+class Checkpointer
+{
+public:
+    long interval;
+    bool async_mode;
+    double bytes;
+    int count;
+    double stall_time;
+    double rate; // bound on remote checkpoint writes, -1 when unbounded
+
+    simgrid::s4u::Host *host;
+    simgrid::s4u::Host *storage_host;
+    simgrid::s4u::Disk *disk;
+    simgrid::s4u::ActivityPtr inflight;
+
+    Checkpointer(const json &settings, double default_bytes)
+    {
+        interval = settings.value("interval", 0L);
+        std::string mode = settings.value("mode", std::string("sync"));
+        xbt_assert(mode == "sync" || mode == "async", "Checkpoint mode must be \"sync\" or \"async\" (got %s)", mode.c_str());
+        async_mode = (mode == "async");
+        bytes = settings.value("bytes", default_bytes);
+        count = 0;
+        stall_time = 0.0;
+        rate = -1.0;
+
+        host = simgrid::s4u::this_actor::get_host();
+        storage_host = nullptr;
+        disk = nullptr;
+        if (interval <= 0)
+            return;
+        if (settings.contains("disk"))
+        {
+            std::string disk_name = settings["disk"].get<std::string>();
+            for (simgrid::s4u::Disk *candidate : host->get_disks())
+                if (candidate->get_name() == disk_name)
+                    disk = candidate;
+            xbt_assert(disk != nullptr, "Host %s has no disk named %s", host->get_cname(), disk_name.c_str());
+        }
+        else
+        {
+            xbt_assert(settings.contains("storage_host"), "Checkpointing needs either a \"disk\" or a \"storage_host\"");
+            storage_host = simgrid::s4u::Host::by_name(settings["storage_host"].get<std::string>());
+        }
+    }
+
+    /**
+     * @brief Write a checkpoint if `completed` (rounds or updates) is a multiple of the interval.
+     *
+     * @param completed
+     */
+    void step(long completed)
+    {
+        if (interval <= 0 || completed % interval != 0)
+            return;
+        double begin = simgrid::s4u::Engine::get_clock();
+        if (inflight)
+        {
+            inflight->wait(); // previous asynchronous checkpoint is still being written
+            inflight = nullptr;
+        }
+        simgrid::s4u::ActivityPtr write;
+        if (disk)
+            write = disk->write_async(static_cast<uint64_t>(bytes));
+        else if (rate > 0)
+            write = simgrid::s4u::Comm::sendto_init(host, storage_host)->set_payload_size(static_cast<uint64_t>(bytes))->set_rate(rate)->start();
+        else
+            write = simgrid::s4u::Comm::sendto_async(host, storage_host, static_cast<uint64_t>(bytes));
+        if (async_mode)
+            inflight = write;
+        else
+            write->wait();
+        double stall = simgrid::s4u::Engine::get_clock() - begin;
+        stall_time += stall;
+        count++;
+        XBT_INFO("[Checkpoint]: #%d after step %ld (%s), server stalled %f s", count, completed, async_mode ? "async" : "sync", stall);
+    }
+
+    void drain()
+    {
+        if (!inflight)
+            return;
+        double begin = simgrid::s4u::Engine::get_clock();
+        inflight->wait();
+        inflight = nullptr;
+        stall_time += simgrid::s4u::Engine::get_clock() - begin;
+    }
+
+    json summary() const
+    {
+        return json{{"count", count}, {"bytes", bytes * count}, {"mode", async_mode ? "async" : "sync"}, {"stall_time", stall_time}};
+    }
+};
+
+/**
+ * @brief Periodic validation of the global model on the server host.
+ *
+ * In "overlap" mode validation runs as an asynchronous activity on the server host, so it only
+ * competes with aggregation for the host cores; it needs a multi-core host, since on a single core
+ * it would just share that core with aggregation. In "blocking" mode the server runs it inline.
+ */
+class Validator
+{
+public:
+    bool enabled, overlap;
+    long interval;
+    double flops;
+    int count;
+    double stall_time;
+
+    simgrid::s4u::ExecPtr inflight;
+
+    Validator(bool enabled, double cost, long interval, const std::string &mode)
+    {
+        xbt_assert(mode == "overlap" || mode == "blocking", "Validation mode must be \"overlap\" or \"blocking\" (got %s)", mode.c_str());
+        xbt_assert(interval > 0, "Validation interval must be positive (got %ld)", interval);
+        this->enabled = enabled;
+        this->overlap = (mode == "overlap");
+        xbt_assert(!enabled || !overlap || simgrid::s4u::this_actor::get_host()->get_core_count() > 1,
+                   "Overlapped validation needs a multi-core server host (%s has one core): generate the platform with --cores or use \"blocking\"",
+                   simgrid::s4u::this_actor::get_host()->get_cname());
+        this->interval = interval;
+        this->flops = cost * simgrid::s4u::this_actor::get_host()->get_speed();
+        count = 0;
+        stall_time = 0.0;
+    }
+
+    /**
+     * @brief Validate if `completed` (rounds or updates) is a multiple of the interval.
+     *
+     * @param completed
+     */
+    void step(long completed)
+    {
+        if (enabled && completed % interval == 0)
+            run(overlap);
+    }
+
+    void run(bool in_background)
+    {
+        double begin = simgrid::s4u::Engine::get_clock();
+        if (inflight)
+        {
+            inflight->wait(); // previous validation has not finished yet
+            inflight = nullptr;
+        }
+        if (in_background)
+            inflight = simgrid::s4u::this_actor::exec_async(flops);
+        else
+            simgrid::s4u::this_actor::execute(flops);
+        stall_time += simgrid::s4u::Engine::get_clock() - begin;
+        count++;
+    }
+
+    void drain()
+    {
+        if (!inflight)
+            return;
+        double begin = simgrid::s4u::Engine::get_clock();
+        inflight->wait();
+        inflight = nullptr;
+        stall_time += simgrid::s4u::Engine::get_clock() - begin;
+    }
+
+    json summary() const
+    {
+        return json{{"count", count}, {"mode", overlap ? "overlap" : "blocking"}, {"stall_time", stall_time}};
+    }
+};
+
+/**
+ * @brief Resident memory of the server for queued uploads and buffered local models.
+ *
+ * Clients reserve room before uploading and the server releases it once the model has been folded
+ * into the global model. When a cap is set, the "backpressure" policy blocks clients until enough
+ * memory is released, while the "spill" policy lets them through and charges the server a spill
+ * write for the overflow (and a read when the spilled model is consumed).
+ */
+class ServerMemory
+{
+public:
+    double cap, resident, peak, spill_bandwidth;
+    double spill_pending, spilled_resident, spilled_bytes, spill_time, blocked_time;
+    bool backpressure;
+
+    simgrid::s4u::MutexPtr mutex;
+    simgrid::s4u::ConditionVariablePtr released;
+
+    ServerMemory(const json &settings)
+    {
+        cap = settings.value("cap", 0.0);
+        std::string policy = settings.value("policy", std::string("backpressure"));
+        xbt_assert(policy == "backpressure" || policy == "spill", "Memory policy must be \"backpressure\" or \"spill\" (got %s)", policy.c_str());
+        backpressure = (policy == "backpressure");
+        spill_bandwidth = settings.value("spill_bandwidth", 1e9);
+        xbt_assert(spill_bandwidth > 0, "Spill bandwidth must be positive");
+        resident = 0.0;
+        peak = 0.0;
+        spill_pending = 0.0;
+        spilled_resident = 0.0;
+        spilled_bytes = 0.0;
+        spill_time = 0.0;
+        blocked_time = 0.0;
+        mutex = simgrid::s4u::Mutex::create();
+        released = simgrid::s4u::ConditionVariable::create();
+    }
+
+    /**
+     * @brief Called by a client before it uploads `bytes` to the server.
+     *
+     * @param bytes
+     */
+    void reserve(double bytes)
+    {
+        if (cap > 0 && backpressure)
+        {
+            double begin = simgrid::s4u::Engine::get_clock();
+            std::unique_lock<simgrid::s4u::Mutex> lock(*mutex);
+            while (resident > 0 && resident + bytes > cap)
+                released->wait(lock);
+            blocked_time += simgrid::s4u::Engine::get_clock() - begin;
+        }
+        else if (cap > 0 && resident + bytes > cap)
+        {
+            spill_pending += std::min(bytes, resident + bytes - cap);
+        }
+        resident += bytes;
+        peak = std::max(peak, resident);
+    }
+
+    /**
+     * @brief Called by the server after receiving an upload: write out whatever overflowed the cap.
+     */
+    void spill()
+    {
+        if (spill_pending <= 0)
+            return;
+        double duration = spill_pending / spill_bandwidth;
+        simgrid::s4u::this_actor::sleep_for(duration);
+        spill_time += duration;
+        spilled_bytes += spill_pending;
+        spilled_resident += spill_pending;
+        spill_pending = 0.0;
+    }
+
+    /**
+     * @brief Called by the server once `bytes` of local models have been consumed.
+     *
+     * @param bytes
+     */
+    void release(double bytes)
+    {
+        if (spilled_resident > 0)
+        {
+            double reload = std::min(bytes, spilled_resident);
+            double duration = reload / spill_bandwidth;
+            simgrid::s4u::this_actor::sleep_for(duration);
+            spill_time += duration;
+            spilled_resident -= reload;
+        }
+        resident = std::max(0.0, resident - bytes);
+        released->notify_all();
+    }
+
+    json summary() const
+    {
+        return json{{"cap", cap}, {"policy", backpressure ? "backpressure" : "spill"}, {"peak_bytes", peak},
+                    {"client_blocked_time", blocked_time}, {"spilled_bytes", spilled_bytes}, {"spill_time", spill_time}};
+    }
+};
+
+/**
+ * @brief CPU cost of moving a model between the server and a client placed on the same host.
+ *
+ * Such transfers go through the host's loopback route, which the platform models as memory
+ * bandwidth. On top of that, every copy (serialization, shared-memory copy) costs CPU time on the
+ * host, so co-located clients are not artificially favored.
+ */
+class IntraNodeModel
+{
+public:
+    double copy_bandwidth; // bytes per second a single core copies, 0 disables the model
+    int copies;
+    double copied_bytes, copy_time;
+    simgrid::s4u::Host *server_host;
+    std::vector<simgrid::s4u::Host *> client_hosts;
+
+    IntraNodeModel(const json &settings, simgrid::s4u::Host *server_host, const std::vector<simgrid::s4u::Host *> &client_hosts)
+    {
+        copy_bandwidth = settings.value("copy_bandwidth", 0.0);
+        copies = settings.value("copies", 1);
+        xbt_assert(copy_bandwidth >= 0 && copies >= 0, "Intra-node copy bandwidth and copy count must be non-negative");
+        copied_bytes = 0.0;
+        copy_time = 0.0;
+        this->server_host = server_host;
+        this->client_hosts = client_hosts;
+    }
+
+    /**
+     * @brief Charge the calling actor for copying `bytes` if `client_id` shares the server host.
+     *
+     * @param client_id
+     * @param bytes
+     */
+    void charge(int client_id, double bytes)
+    {
+        if (copy_bandwidth <= 0 || client_hosts[client_id] != server_host)
+            return;
+        double duration = copies * bytes / copy_bandwidth;
+        simgrid::s4u::this_actor::execute(duration * simgrid::s4u::this_actor::get_host()->get_speed());
+        copied_bytes += copies * bytes;
+        copy_time += duration;
+    }
+
+    json summary() const
+    {
+        return json{{"copied_bytes", copied_bytes}, {"copy_time", copy_time}};
+    }
+};
+
+/**
+ * @brief Mergeable streaming quantile sketch with relative accuracy `alpha` (DDSketch-style
+ * logarithmic buckets, as in HDR histograms).
+ *
+ * A positive sample x falls in bucket ceil(log_gamma(x)) with gamma = (1 + alpha) / (1 - alpha),
+ * and any quantile is returned within `alpha` of a true sample. The size only depends on the
+ * dynamic range of the samples, not on their number: with the default alpha of 1%, 1 us to 1e6 s
+ * fits in about 1,400 buckets. Past `max_buckets`, the lowest buckets are collapsed. Two sketches
+ * with the same alpha merge by adding their bucket counts, so sketches from several runs can be
+ * combined (see simulation/analysis/merge_latency_sketches.py).
+ */
+class QuantileSketch
+{
+public:
+    static constexpr size_t max_buckets = 2048;
+    double alpha, log_gamma;
+    std::map<int, long> buckets;
+    long count, zeros;
+    double min, max, sum;
+
+    explicit QuantileSketch(double alpha)
+    {
+        xbt_assert(alpha > 0 && alpha < 1, "Sketch accuracy must be within (0, 1) (got %f)", alpha);
+        this->alpha = alpha;
+        log_gamma = std::log((1 + alpha) / (1 - alpha));
+        count = 0;
+        zeros = 0;
+        min = std::numeric_limits<double>::infinity();
+        max = 0.0;
+        sum = 0.0;
+    }
+
+    void add(double value)
+    {
+        count++;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        if (value <= 0)
+        {
+            zeros++;
+            return;
+        }
+        buckets[static_cast<int>(std::ceil(std::log(value) / log_gamma))]++;
+        if (buckets.size() > max_buckets)
+        {
+            auto lowest = buckets.begin();
+            std::next(lowest)->second += lowest->second;
+            buckets.erase(lowest);
+        }
+    }
+
+    double quantile(double q) const
+    {
+        if (count == 0)
+            return 0.0;
+        long rank = static_cast<long>(q * (count - 1));
+        if (rank < zeros)
+            return 0.0;
+        long seen = zeros;
+        for (const auto &[index, bucket_count] : buckets)
+        {
+            seen += bucket_count;
+            if (seen > rank)
+                return std::clamp(2 * std::exp(index * log_gamma) / (1 + std::exp(log_gamma)), min, max);
+        }
+        return max;
+    }
+
+    json summary() const
+    {
+        json bucket_counts = json::object();
+        for (const auto &[index, bucket_count] : buckets)
+            bucket_counts[std::to_string(index)] = bucket_count;
+        return json{{"alpha", alpha}, {"count", count}, {"zeros", zeros}, {"min", count > 0 ? min : 0.0}, {"max", max},
+                    {"mean", count > 0 ? sum / count : 0.0}, {"p50", quantile(0.5)}, {"p99", quantile(0.99)}, {"p999", quantile(0.999)},
+                    {"buckets", bucket_counts}};
+    }
+};
+
+/**
+ * @brief Latency distributions of the run, kept as one quantile sketch per metric:
+ *   round_trip  end of the model download to a client until its update reaches the server
+ *   queueing    start of an upload until the server takes it in
+ *   upload      transfer time of an upload once the server takes it in
+ */
+class LatencyMetrics
+{
+public:
+    double alpha;
+    std::map<std::string, QuantileSketch> sketches;
+    std::unordered_map<int, double> sent_at;
+
+    LatencyMetrics(const json &settings)
+    {
+        alpha = settings.value("alpha", 0.01);
+        for (const char *metric : {"round_trip", "queueing", "upload"})
+            sketches.emplace(metric, QuantileSketch(alpha));
+    }
+
+    void record(const std::string &metric, double value)
+    {
+        sketches.at(metric).add(value);
+    }
+
+    /**
+     * @brief Record the queueing and transfer time of a finished upload started at `begin`. With
+     * `ahead`, most of its data went as separate flows from `begin` on, so it did not queue.
+     */
+    void uploaded(const simgrid::s4u::CommPtr &upload, double begin, bool ahead = false)
+    {
+        double started = ahead ? begin : std::max(begin, upload->get_start_time());
+        record("queueing", started - begin);
+        record("upload", simgrid::s4u::Engine::get_clock() - started);
+    }
+
+    /**
+     * @brief The server finished sending a model to `client_id`.
+     */
+    void sent(int client_id)
+    {
+        sent_at[client_id] = simgrid::s4u::Engine::get_clock();
+    }
+
+    /**
+     * @brief The update of `client_id` reached the server.
+     */
+    void arrived(int client_id)
+    {
+        auto it = sent_at.find(client_id);
+        if (it != sent_at.end())
+            record("round_trip", simgrid::s4u::Engine::get_clock() - it->second);
+    }
+
+    json summary() const
+    {
+        json result = json::object();
+        for (const auto &[metric, sketch] : sketches)
+            result[metric] = sketch.summary();
+        return result;
+    }
+};
+
+// Created by main() before the actors, filled in by the server and the clients around model transfers.
+static LatencyMetrics *latency = nullptr;
+
+// Completed rounds (FedAvg), updates (FedAsync) or scheduler iterations (FedCompass), advanced by the server.
+static long progress = 0;
+
+/**
+ * @brief Progress heartbeat for long runs, driven by the engine's time advances.
+ *
+ * Every `interval` wall-clock seconds it reports the simulated time, the completed rounds (or
+ * updates), the simulation events (time advances) per second, the simulated-to-real time ratio,
+ * the resident set size and an estimated finish time. The line goes to stderr, or the same
+ * fields as JSON overwrite `file` so that a sweep driver can poll it and kill runaway points.
+ * The wall clock is only read every 256 events to keep the hot path cheap.
+ */
+class Heartbeat
+{
+public:
+    double interval;
+    std::string file;
+    long total, events;
+    std::chrono::steady_clock::time_point start, last;
+
+    Heartbeat(const json &settings, long total)
+    {
+        interval = settings.value("interval", 10.0);
+        file = settings.value("file", std::string());
+        xbt_assert(interval > 0, "Heartbeat interval must be positive (got %f)", interval);
+        this->total = total;
+        events = 0;
+        start = std::chrono::steady_clock::now();
+        last = start;
+    }
+
+    static double resident_bytes()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long pages = 0, resident = 0;
+        statm >> pages >> resident;
+        return static_cast<double>(resident) * sysconf(_SC_PAGESIZE);
+    }
+
+    void tick()
+    {
+        if (++events % 256 != 0)
+            return;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - last).count() < interval)
+            return;
+        last = now;
+        beat(std::chrono::duration<double>(now - start).count());
+    }
+
+    void beat(double wall_time)
+    {
+        double simulated = simgrid::s4u::Engine::get_clock();
+        double eta = progress > 0 ? wall_time * (total - progress) / progress : -1.0;
+        json status{{"simulated_time", simulated}, {"done", progress}, {"total", total}, {"events_per_second", events / wall_time},
+                    {"time_ratio", simulated / wall_time}, {"rss_bytes", resident_bytes()}, {"wall_time", wall_time}, {"eta", eta}};
+        if (file.empty())
+        {
+            std::fprintf(stderr, "[Heartbeat]: simulated %.1f s, %ld/%ld done, %.0f events/s, %.2fx real time, RSS %.1f MiB, ETA %.0f s\n",
+                         simulated, progress, total, events / wall_time, simulated / wall_time, resident_bytes() / (1 << 20), eta);
+            return;
+        }
+        std::ofstream out(file, std::ios::trunc);
+        out << status.dump() << std::endl;
+    }
+};
+
+// Created by main() when the configuration has a "heartbeat" section, driven by the engine.
+static Heartbeat *heartbeat = nullptr;
+
+/**
+ * @brief Budgets on the simulated time, the wall-clock time and the number of simulation events
+ * (time advances) of a run.
+ *
+ * The run advances in slices of simulated time, sized so that the budgets are checked about once
+ * per wall-clock second. The run is complete once the server actor exits, even if clients are still
+ * blocked (FedAsync leaves the clients that were training when it finished). Otherwise, once a
+ * budget is spent, the run stops at the end of the slice, and the actors still running are killed
+ * when the engine shuts down. The report is then partial: it has "truncated" set, and names the
+ * budget in "budget.stopped_by".
+ */
+class Budget
+{
+public:
+    double max_simulated_time, max_wall_time;
+    long max_events, events;
+    double completed_at; // when the server exited, -1 while it runs
+    std::string stopped_by; // name of the budget that stopped the run, empty if it completed
+    std::chrono::steady_clock::time_point start;
+
+    Budget(const json &settings)
+    {
+        max_simulated_time = settings.value("simulated_time", 0.0);
+        max_wall_time = settings.value("wall_time", 0.0);
+        max_events = settings.value("events", 0L);
+        xbt_assert(max_simulated_time > 0 || max_wall_time > 0 || max_events > 0,
+                   "A \"budget\" needs a positive \"simulated_time\", \"wall_time\" or \"events\"");
+        events = 0;
+        completed_at = -1.0;
+        start = std::chrono::steady_clock::now();
+        simgrid::s4u::Engine::on_time_advance_cb([this](double) { events++; });
+    }
+
+    double wall_time() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string spent() const
+    {
+        if (max_simulated_time > 0 && simgrid::s4u::Engine::get_clock() >= max_simulated_time)
+            return "simulated_time";
+        if (max_wall_time > 0 && wall_time() >= max_wall_time)
+            return "wall_time";
+        if (max_events > 0 && events >= max_events)
+            return "events";
+        return "";
+    }
+
+    /**
+     * @brief Run the simulation until `server` exits or a budget is spent.
+     */
+    void run(const simgrid::s4u::Engine &e, const simgrid::s4u::ActorPtr &server)
+    {
+        server->on_exit([this](bool) { completed_at = simgrid::s4u::Engine::get_clock(); });
+        double slice = 1.0;
+        while (e.get_actor_count() > 0)
+        {
+            double horizon = e.get_clock() + slice;
+            if (max_simulated_time > 0)
+                horizon = std::min(horizon, max_simulated_time);
+            double begin = wall_time();
+            e.run_until(horizon);
+            if (completed_at >= 0 || e.get_actor_count() == 0)
+                return;
+            stopped_by = spent();
+            if (!stopped_by.empty())
+            {
+                XBT_INFO("[Budget]: %s budget spent, stopping the run", stopped_by.c_str());
+                return;
+            }
+            slice *= std::clamp(1.0 / std::max(wall_time() - begin, 1e-3), 0.5, 2.0);
+        }
+    }
+
+    /**
+     * @brief Simulated end of the run: when the server exited, rather than the end of the last slice.
+     */
+    double end_time() const
+    {
+        return completed_at >= 0 ? completed_at : simgrid::s4u::Engine::get_clock();
+    }
+
+    json summary() const
+    {
+        return json{{"stopped_by", stopped_by.empty() ? json(nullptr) : json(stopped_by)}, {"wall_time", wall_time()}, {"events", events}};
+    }
+};
+
+// Created by main() when the configuration has a "budget" section.
+static Budget *budget = nullptr;
+
+/**
+ * @brief Fingerprint of the simulated timeline: an FNV-1a hash over the clock of every event
+ * (time advance) of a run.
+ *
+ * Two runs of the same seeded configuration on the same platform produce the same checksum, so
+ * a changed checksum shows that a simulator change moved at least one event. The regression
+ * harness (simulation/regression/golden_timeline.py) compares it against stored goldens.
+ */
+class TimelineChecksum
+{
+public:
+    uint64_t hash = 14695981039346656037ULL;
+    long events = 0;
+
+    TimelineChecksum()
+    {
+        simgrid::s4u::Engine::on_time_advance_cb([this](double) { add(simgrid::s4u::Engine::get_clock()); });
+    }
+
+    void add(double clock)
+    {
+        unsigned char bytes[sizeof(double)];
+        std::memcpy(bytes, &clock, sizeof(double));
+        for (unsigned char byte : bytes)
+        {
+            hash ^= byte;
+            hash *= 1099511628211ULL;
+        }
+        events++;
+    }
+
+    json summary() const
+    {
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        return json{{"events", events}, {"checksum", hex}};
+    }
+};
+
+// Created by main() before the run, reported in "timeline".
+static TimelineChecksum *timeline = nullptr;
+
+/**
+ * @brief Typed message from the server to a client, on either plane.
+ */
+struct ServerMessage
+{
+    enum Kind
+    {
+        MODEL,
+        TERMINATE
+    };
+    Kind kind;
+    double model_size; // size of the client's model, piggybacked so it needs no message of its own
+    long round;        // version of the model, the global round it was produced in
+    int local_steps;   // local steps to train on the model (FedCompass)
+};
+
+/**
+ * @brief Control plane between the server and its clients, kept apart from the model transfers.
+ *
+ * Each client has a "<id>-ctl" mailbox for control messages next to its "<id>" model mailbox.
+ * Control fields ride on a model download when there is one. Only a message with no download to
+ * piggyback on, like termination, goes out on its own on the control mailbox.
+ */
+class ControlPlane
+{
+public:
+    static constexpr double message_bytes = 4;
+    long sent, piggybacked;
+    double control_time;
+
+    ControlPlane()
+    {
+        sent = 0;
+        piggybacked = 0;
+        control_time = 0.0;
+    }
+
+    static simgrid::s4u::Mailbox *mailbox(int client_id)
+    {
+        return simgrid::s4u::Mailbox::by_name(std::to_string(client_id) + "-ctl");
+    }
+
+    /**
+     * @brief Payload of a model download, with the control fields piggybacked on it.
+     *
+     * The model version travels with the model: by the time the client reads it, the server may
+     * have moved on to a later round.
+     */
+    ServerMessage *model(double model_size, long round, int local_steps = 0)
+    {
+        piggybacked++;
+        return new ServerMessage{ServerMessage::MODEL, model_size, round, local_steps};
+    }
+
+    /**
+     * @brief Send a message of its own on the control mailbox of `client_id`.
+     *
+     * @param client_id
+     * @param kind
+     * @param rate bound of the transfer, -1 when unbounded
+     */
+    void send(int client_id, ServerMessage::Kind kind, double rate = -1.0)
+    {
+        double begin = simgrid::s4u::Engine::get_clock();
+        put_bounded(mailbox(client_id), new ServerMessage{kind, 0.0, 0, 0}, message_bytes, rate);
+        sent++;
+        control_time += simgrid::s4u::Engine::get_clock() - begin;
+    }
+
+    /**
+     * @brief Wait for the next message to a client on either plane, once `download` is posted on its model mailbox.
+     *
+     * @param download pending receive of `model`
+     * @param model
+     * @param my_control control mailbox of the client
+     */
+    static ServerMessage *wait(simgrid::s4u::CommPtr download, ServerMessage *&model, simgrid::s4u::Mailbox *my_control)
+    {
+        ServerMessage *signal = nullptr;
+        simgrid::s4u::CommPtr control = my_control->get_async<ServerMessage>(&signal);
+        simgrid::s4u::ActivitySet pending;
+        pending.push(download);
+        pending.push(control);
+        if (pending.wait_any() == download)
+        {
+            control->cancel();
+            return model;
+        }
+        download->cancel();
+        return signal;
+    }
+
+    static ServerMessage *receive(simgrid::s4u::Mailbox *my_mailbox, simgrid::s4u::Mailbox *my_control)
+    {
+        ServerMessage *model = nullptr;
+        simgrid::s4u::CommPtr download = my_mailbox->get_async<ServerMessage>(&model);
+        return wait(download, model, my_control);
+    }
+
+    json summary() const
+    {
+        return json{{"messages", sent}, {"bytes", sent * message_bytes}, {"piggybacked", piggybacked}, {"time", control_time}};
+    }
+};
+
+// Created by main() before the actors, used by the server to reach the clients outside of model transfers.
+static ControlPlane *control_plane = nullptr;
+
+/**
+ * @brief Round-indexed payload schedule, e.g. a full-model warm-up followed by adapter-only updates.
+ *
+ * Each phase starts at round `from` and scales the model bytes of downloads and uploads. Rounds are
+ * FedAvg rounds, or global model updates for the asynchronous algorithms. The schedule is given
+ * inline or as a trace of "<from> <download scale> <upload scale> [name]" lines. Transfer time is
+ * accumulated per phase.
+ */
+class PayloadSchedule
+{
+public:
+    struct Phase
+    {
+        long from;
+        double download, upload;
+        std::string name;
+        long transfers;
+        double bytes, comm_time;
+    };
+
+    std::vector<Phase> phases;
+    long round; // current global round, advanced by the server
+
+    PayloadSchedule(const json &settings)
+    {
+        round = 0;
+        if (settings.is_object() && settings.contains("trace"))
+            load_trace(settings["trace"].get<std::string>());
+        else
+        {
+            xbt_assert(settings.is_array(), "\"payload_schedule\" must be an array of phases or an object with a \"trace\"");
+            for (const auto &phase : settings)
+            {
+                double scale = phase.value("scale", 1.0);
+                phases.push_back(Phase{phase.value("from", 0L), phase.value("download", scale), phase.value("upload", scale),
+                                       phase.value("name", "phase-" + std::to_string(phases.size())), 0, 0.0, 0.0});
+            }
+        }
+        std::stable_sort(phases.begin(), phases.end(), [](const Phase &a, const Phase &b) { return a.from < b.from; });
+        if (phases.empty() || phases.front().from > 0)
+            phases.insert(phases.begin(), Phase{0, 1.0, 1.0, "full", 0, 0.0, 0.0});
+        for (const Phase &phase : phases)
+            xbt_assert(phase.download > 0 && phase.upload > 0, "Payload scales of phase %s must be positive", phase.name.c_str());
+    }
+
+    void load_trace(const std::string &path)
+    {
+        std::ifstream file(path);
+        xbt_assert(file.good(), "Cannot open payload schedule %s", path.c_str());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            Phase phase{0, 1.0, 1.0, "", 0, 0.0, 0.0};
+            fields >> phase.from >> phase.download >> phase.upload;
+            xbt_assert(!fields.fail(), "Invalid payload phase \"%s\" in %s", line.c_str(), path.c_str());
+            if (!(fields >> phase.name))
+                phase.name = "phase-" + std::to_string(phases.size());
+            phases.push_back(phase);
+        }
+    }
+
+    Phase &at(long round)
+    {
+        size_t index = 0;
+        while (index + 1 < phases.size() && phases[index + 1].from <= round)
+            index++;
+        return phases[index];
+    }
+
+    /**
+     * @brief Bytes of a download or upload of a `base_bytes` model in `round`.
+     */
+    double bytes(double base_bytes, long round, bool upload)
+    {
+        const Phase &phase = at(round);
+        return base_bytes * (upload ? phase.upload : phase.download);
+    }
+
+    /**
+     * @brief Blocking put of a `round` model, charged to the phase of that round.
+     *
+     * @param mailbox
+     * @param payload
+     * @param base_bytes full model size
+     * @param round
+     * @param upload
+     * @param rate bound of the transfer, -1 when unbounded
+     * @param carried share of the bytes carried by the message, the rest went ahead since `begin`
+     * @param begin start of the transfer, -1 for now
+     */
+    void put(simgrid::s4u::Mailbox *mailbox, void *payload, double base_bytes, long round, bool upload, double rate = -1.0, double carried = 1.0,
+             double begin = -1.0)
+    {
+        double size = bytes(base_bytes, round, upload);
+        if (begin < 0)
+            begin = simgrid::s4u::Engine::get_clock();
+        simgrid::s4u::CommPtr comm = mailbox->put_init(payload, static_cast<uint64_t>(size * carried));
+        if (rate > 0)
+            comm->set_rate(rate);
+        comm->wait();
+        if (upload)
+            latency->uploaded(comm, begin, carried < 1.0);
+        record(round, size, simgrid::s4u::Engine::get_clock() - begin);
+    }
+
+    /**
+     * @brief Charge a transfer made outside of put() to the phase of `round`.
+     *
+     * @param round
+     * @param size bytes transferred
+     * @param comm_time from posting the transfer to its completion
+     */
+    void record(long round, double size, double comm_time)
+    {
+        Phase &phase = at(round);
+        phase.transfers++;
+        phase.bytes += size;
+        phase.comm_time += comm_time;
+    }
+
+    json summary() const
+    {
+        json result = json::array();
+        for (const Phase &phase : phases)
+            result.push_back(json{{"name", phase.name}, {"from", phase.from}, {"download_scale", phase.download}, {"upload_scale", phase.upload},
+                                  {"transfers", phase.transfers}, {"bytes", phase.bytes}, {"comm_time", phase.comm_time}});
+        return result;
+    }
+};
+
+// Created by main() before the actors, used by the server and the clients to size model transfers.
+static PayloadSchedule *payload = nullptr;
+
+// Created by main() before the actors, used by the server and the clients around model transfers.
+static IntraNodeModel *intra_node = nullptr;
+
+// Created by the server before the first model goes out, used by the clients to reserve upload room.
+static ServerMemory *server_memory = nullptr;
+
+/**
+ * @brief Pipelined clients: the upload of a local model overlaps with training on the stale model.
+ *
+ * After training, a pipelined client starts its upload asynchronously and keeps training on the
+ * stale model until the next global model arrives. In "merge" mode the partial progress is merged
+ * into the new model and counts toward the next local update. In "restart" mode it is dropped.
+ */
+class ClientPipeline
+{
+public:
+    bool enabled, merge;
+    long exchanges;
+    double overlap_time, carried_flops, wasted_flops;
+
+    ClientPipeline(const std::string &mode)
+    {
+        xbt_assert(mode == "off" || mode == "merge" || mode == "restart", "Client pipeline must be \"off\", \"merge\" or \"restart\" (got %s)", mode.c_str());
+        enabled = (mode != "off");
+        merge = (mode == "merge");
+        exchanges = 0;
+        overlap_time = 0.0;
+        carried_flops = 0.0;
+        wasted_flops = 0.0;
+    }
+
+    /**
+     * @brief Upload `update` and wait for the server's reply, training on the stale model meanwhile.
+     *
+     * @param server_mailbox
+     * @param update payload of the upload
+     * @param base_bytes full model size
+     * @param round version of the model the update was trained on
+     * @param my_mailbox
+     * @param my_control
+     * @param stale_flops size of a local update, the most the client trains ahead
+     * @param carried set to the flops of the next local update already done
+     * @return the server's reply, a new model or a control message
+     */
+    ServerMessage *exchange(simgrid::s4u::Mailbox *server_mailbox, void *update, double base_bytes, long round, simgrid::s4u::Mailbox *my_mailbox,
+                            simgrid::s4u::Mailbox *my_control, double stale_flops, double &carried)
+    {
+        double begin = simgrid::s4u::Engine::get_clock();
+        double upload_bytes = payload->bytes(base_bytes, round, true);
+        ServerMessage *model = nullptr;
+        simgrid::s4u::CommPtr upload = server_mailbox->put_async(update, upload_bytes);
+        simgrid::s4u::CommPtr download = my_mailbox->get_async<ServerMessage>(&model);
+        simgrid::s4u::ExecPtr stale = simgrid::s4u::this_actor::exec_async(stale_flops);
+        upload->wait();
+        latency->uploaded(upload, begin);
+        // timed like a blocking put, from posting to completion, so the phase totals cover pipelined uploads too
+        payload->record(round, upload_bytes, upload->get_finish_time() - begin);
+        ServerMessage *reply = ControlPlane::wait(download, model, my_control);
+        double done = stale_flops;
+        if (!stale->test())
+        {
+            done = stale_flops - stale->get_remaining();
+            stale->cancel();
+        }
+        carried = merge ? done : 0.0;
+        exchanges++;
+        overlap_time += simgrid::s4u::Engine::get_clock() - begin;
+        carried_flops += carried;
+        wasted_flops += done - carried;
+        return reply;
+    }
+
+    json summary() const
+    {
+        return json{{"mode", !enabled ? "off" : merge ? "merge" : "restart"}, {"exchanges", exchanges}, {"overlap_time", overlap_time},
+                    {"carried_flops", carried_flops}, {"wasted_flops", wasted_flops}};
+    }
+};
+
+/**
+ * @brief Pool of client slots whose occupancy is driven by arrival and departure processes.
+ *
+ * Arrivals take the lowest free slot, spawn a client actor for it and onboard it from the server
+ * host. Departures are graceful: the client is marked as leaving and the server retires it with a
+ * termination signal at its next upload, instead of sending it a new global model.
+ */
+class Population
+{
+public:
+    enum class SlotState
+    {
+        EMPTY,
+        ACTIVE,
+        LEAVING
+    };
+
+    struct TraceEvent
+    {
+        double time;
+        bool join;
+        int client; // -1 picks a random active client for departures
+    };
+
+    std::vector<SlotState> slots;
+    std::vector<TraceEvent> trace;
+    int initial, size, arrivals, departures;
+    double arrival_rate, departure_rate, sample_interval;
+    long updates, sampled_updates;
+    bool closed;
+    json timeline;
+    std::mt19937 gen;
+
+    std::function<void(int)> spawn;   // creates the client actor of a slot, set by main()
+    std::function<void(int)> onboard; // sends the current global model to a new client, set by the server
+    simgrid::s4u::SemaphorePtr opened;
+
+    Population(const json &settings, int num_slots, unsigned seed) : gen(seed)
+    {
+        slots.assign(num_slots, SlotState::EMPTY);
+        initial = settings.value("initial", num_slots);
+        xbt_assert(initial >= 0 && initial <= num_slots, "Initial population must be within 0-%d (got %d)", num_slots, initial);
+        arrival_rate = settings.value("arrival_rate", 0.0);
+        departure_rate = settings.value("departure_rate", 0.0);
+        sample_interval = settings.value("sample_interval", 60.0);
+        xbt_assert(arrival_rate >= 0 && departure_rate >= 0, "Arrival and departure rates must be non-negative");
+        xbt_assert(sample_interval > 0, "Population sample interval must be positive");
+        if (settings.contains("trace"))
+            load_trace(settings["trace"].get<std::string>());
+        size = 0;
+        arrivals = 0;
+        departures = 0;
+        updates = 0;
+        sampled_updates = 0;
+        closed = false;
+        timeline = json::array();
+        opened = simgrid::s4u::Semaphore::create(0);
+    }
+
+    /**
+     * @brief Read "<time> join" and "<time> leave [client]" lines, sorted by time.
+     *
+     * @param path
+     */
+    void load_trace(const std::string &path)
+    {
+        std::ifstream file(path);
+        xbt_assert(file.good(), "Cannot open population trace %s", path.c_str());
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            TraceEvent event{0.0, true, -1};
+            std::string kind;
+            fields >> event.time >> kind;
+            xbt_assert(kind == "join" || kind == "leave", "Unknown population event \"%s\" in %s", kind.c_str(), path.c_str());
+            event.join = (kind == "join");
+            fields >> event.client;
+            trace.push_back(event);
+        }
+        std::stable_sort(trace.begin(), trace.end(), [](const TraceEvent &a, const TraceEvent &b) { return a.time < b.time; });
+    }
+
+    bool dynamic() const { return arrival_rate > 0 || departure_rate > 0 || !trace.empty(); }
+    bool present(int client_id) const { return slots[client_id] != SlotState::EMPTY; }
+    bool leaving(int client_id) const { return slots[client_id] == SlotState::LEAVING; }
+
+    void start(int client_id)
+    {
+        slots[client_id] = SlotState::ACTIVE;
+        size++;
+        spawn(client_id);
+    }
+
+    void retire(int client_id)
+    {
+        slots[client_id] = SlotState::EMPTY;
+        size--;
+        departures++;
+        XBT_INFO("[Population]: Client %d retired, population is %d", client_id, size);
+    }
+
+    void join()
+    {
+        if (closed)
+            return; // the server no longer sends models, a new client would wait forever
+        auto free_slot = std::find(slots.begin(), slots.end(), SlotState::EMPTY);
+        if (free_slot == slots.end())
+        {
+            XBT_INFO("[Population]: No free client slot, arrival dropped");
+            return;
+        }
+        int client_id = static_cast<int>(free_slot - slots.begin());
+        start(client_id);
+        arrivals++;
+        simgrid::s4u::Actor::create("onboard_" + std::to_string(client_id), simgrid::s4u::this_actor::get_host(),
+                                    [this, client_id]() { onboard(client_id); });
+        XBT_INFO("[Population]: Client %d joined, population is %d", client_id, size);
+    }
+
+    void leave(int client_id)
+    {
+        if (client_id < 0)
+        {
+            std::vector<int> candidates;
+            for (size_t i = 0; i < slots.size(); i++)
+                if (slots[i] == SlotState::ACTIVE)
+                    candidates.push_back(static_cast<int>(i));
+            if (candidates.empty())
+                return;
+            client_id = candidates[std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(gen)];
+        }
+        if (client_id >= static_cast<int>(slots.size()) || slots[client_id] != SlotState::ACTIVE)
+            return;
+        slots[client_id] = SlotState::LEAVING;
+        XBT_INFO("[Population]: Client %d is leaving after its next upload", client_id);
+    }
+
+    void sample()
+    {
+        double updates_per_hour = (updates - sampled_updates) * 3600.0 / sample_interval;
+        timeline.push_back(json{simgrid::s4u::Engine::get_clock(), size, updates_per_hour});
+        sampled_updates = updates;
+    }
+
+    /**
+     * @brief Body of the population manager actor. Exponential processes are resampled after
+     * every event, which is exact since they are memoryless.
+     */
+    void run()
+    {
+        opened->acquire(); // wait until the server can onboard clients
+        double infinity = std::numeric_limits<double>::infinity();
+        size_t next_trace = 0;
+        double next_sample = simgrid::s4u::Engine::get_clock() + sample_interval;
+        while (!closed)
+        {
+            double now = simgrid::s4u::Engine::get_clock();
+            int active = static_cast<int>(std::count(slots.begin(), slots.end(), SlotState::ACTIVE));
+            double next_arrival = arrival_rate > 0 ? now + std::exponential_distribution<double>(arrival_rate)(gen) : infinity;
+            double next_departure = (departure_rate > 0 && active > 0) ? now + std::exponential_distribution<double>(departure_rate * active)(gen) : infinity;
+            double trace_time = next_trace < trace.size() ? std::max(now, trace[next_trace].time) : infinity;
+            double wake = std::min({next_arrival, next_departure, trace_time, next_sample});
+
+            simgrid::s4u::this_actor::sleep_until(wake);
+            if (closed)
+                break;
+            if (wake == next_sample)
+            {
+                sample();
+                next_sample += sample_interval;
+            }
+            else if (wake == trace_time)
+            {
+                const TraceEvent &event = trace[next_trace++];
+                if (event.join)
+                    join();
+                else
+                    leave(event.client);
+            }
+            else if (wake == next_arrival)
+                join();
+            else
+                leave(-1);
+        }
+    }
+
+    json summary() const
+    {
+        return json{{"initial", initial}, {"final", size}, {"arrivals", arrivals}, {"departures", departures},
+                    {"timeline", timeline}}; // [time, population, updates per hour]
+    }
+};
+
+/**
+ * @brief Cross traffic of other tenants sharing the fabric with the FL transfers.
+ *
+ * Each generator runs in a daemon actor and starts host-to-host flows outside of any mailbox, so
+ * they only compete with the FL transfers for link bandwidth. Flow endpoints are the generator's
+ * "src" and "dst" hosts, or random distinct hosts with a route between them when omitted:
+ *   poisson  flows of `size` bytes arriving at `rate` flows per second
+ *   onoff    exponential on periods (mean `on` seconds) sending `size`-byte flows back to back
+ *            between one host pair, separated by exponential off periods (mean `off` seconds)
+ *   trace    "<time> <src> <dst> <bytes>" lines read from `file`
+ */
+class BackgroundTraffic
+{
+public:
+    struct Flow
+    {
+        double time;
+        std::string src, dst;
+        double bytes;
+    };
+
+    json generators;
+    std::vector<std::vector<Flow>> traces;
+    std::vector<simgrid::s4u::Host *> hosts;
+    std::unordered_map<simgrid::s4u::Host *, std::vector<simgrid::s4u::Host *>> peers; // empty when every pair is routed
+    double baseline_time;
+    long flows;
+    double offered_bytes;
+    std::mt19937 gen;
+
+    BackgroundTraffic(const json &settings, unsigned seed) : gen(seed)
+    {
+        generators = settings.value("generators", json::array());
+        xbt_assert(generators.is_array(), "Background \"generators\" must be a JSON array");
+        baseline_time = settings.value("baseline_time", 0.0);
+        hosts = simgrid::s4u::Engine::get_instance()->get_all_hosts();
+        load_routes();
+        for (const auto &generator : generators)
+        {
+            std::string pattern = generator.value("pattern", std::string());
+            if (pattern == "poisson")
+                xbt_assert(generator.value("rate", 0.0) > 0 && generator.value("size", 0.0) > 0, "Poisson background traffic needs a positive \"rate\" and \"size\"");
+            else if (pattern == "onoff")
+                xbt_assert(generator.value("on", 0.0) > 0 && generator.value("off", 0.0) > 0 && generator.value("size", 0.0) > 0,
+                           "On/off background traffic needs a positive \"on\", \"off\" and \"size\"");
+            else
+                xbt_assert(pattern == "trace", "Background pattern must be \"poisson\", \"onoff\" or \"trace\" (got %s)", pattern.c_str());
+            traces.push_back(pattern == "trace" ? load_trace(generator.at("file").get<std::string>()) : std::vector<Flow>());
+        }
+        flows = 0;
+        offered_bytes = 0.0;
+    }
+
+    std::vector<Flow> load_trace(const std::string &path)
+    {
+        std::ifstream file(path);
+        xbt_assert(file.good(), "Cannot open background traffic trace %s", path.c_str());
+        std::vector<Flow> trace;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream fields(line);
+            Flow flow{0.0, "", "", 0.0};
+            fields >> flow.time >> flow.src >> flow.dst >> flow.bytes;
+            xbt_assert(!fields.fail() && flow.bytes > 0, "Invalid background flow \"%s\" in %s", line.c_str(), path.c_str());
+            trace.push_back(flow);
+        }
+        std::stable_sort(trace.begin(), trace.end(), [](const Flow &a, const Flow &b) { return a.time < b.time; });
+        return trace;
+    }
+
+    /**
+     * @brief Routed host pairs of platforms generated with the "star" or "hierarchy" traffic pattern,
+     * which the generator records in the "traffic" (and "group_size") properties of the root zone.
+     * Only the server Node-1 reaches every host there, and the wireless cells are routed as a star.
+     */
+    void load_routes()
+    {
+        simgrid::s4u::NetZone *root = simgrid::s4u::Engine::get_instance()->get_netzone_root();
+        const char *property = root->get_property("traffic");
+        std::string traffic = property ? property : "full";
+        if (traffic == "full")
+            return;
+        xbt_assert(traffic == "star" || traffic == "hierarchy", "Unknown platform traffic pattern %s", traffic.c_str());
+        const char *group_property = root->get_property("group_size");
+        int group_size = group_property ? std::stoi(group_property) : 8;
+        auto connect = [this](int i, int j)
+        {
+            simgrid::s4u::Host *a = simgrid::s4u::Host::by_name("Node-" + std::to_string(i));
+            simgrid::s4u::Host *b = simgrid::s4u::Host::by_name("Node-" + std::to_string(j));
+            peers[a].push_back(b);
+            peers[b].push_back(a);
+        };
+        int num_nodes = static_cast<int>(hosts.size());
+        for (int j = 2; j <= num_nodes; j++)
+        {
+            connect(1, j);
+            int leader = (j - 1) / group_size * group_size + 1;
+            if (traffic == "hierarchy" && leader != j && leader != 1)
+                connect(leader, j);
+        }
+    }
+
+    /**
+     * @brief A random host with a route to `other`, or any host that has a route when `other` is null.
+     */
+    simgrid::s4u::Host *random_peer(simgrid::s4u::Host *other)
+    {
+        if (!peers.empty())
+        {
+            if (other == nullptr)
+            {
+                std::uniform_int_distribution<size_t> pick(0, hosts.size() - 1);
+                other = hosts[pick(gen)];
+                while (peers.find(other) == peers.end())
+                    other = hosts[pick(gen)];
+                return other;
+            }
+            auto found = peers.find(other);
+            xbt_assert(found != peers.end(), "Background traffic: no host has a route to %s", other->get_cname());
+            std::uniform_int_distribution<size_t> pick(0, found->second.size() - 1);
+            return found->second[pick(gen)];
+        }
+        xbt_assert(hosts.size() > 1, "Background traffic between random hosts needs at least two hosts");
+        std::uniform_int_distribution<size_t> pick(0, hosts.size() - 1);
+        simgrid::s4u::Host *host = hosts[pick(gen)];
+        while (host == other)
+            host = hosts[pick(gen)];
+        return host;
+    }
+
+    /**
+     * @brief Source and destination of the next flow of `generator`; the missing ones are drawn among
+     * the hosts routed to the other endpoint.
+     */
+    std::pair<simgrid::s4u::Host *, simgrid::s4u::Host *> endpoints(const json &generator)
+    {
+        simgrid::s4u::Host *src = generator.contains("src") ? simgrid::s4u::Host::by_name(generator["src"].get<std::string>()) : nullptr;
+        simgrid::s4u::Host *dst = generator.contains("dst") ? simgrid::s4u::Host::by_name(generator["dst"].get<std::string>()) : nullptr;
+        if (src == nullptr)
+            src = random_peer(dst);
+        if (dst == nullptr)
+            dst = random_peer(src);
+        return {src, dst};
+    }
+
+    void start(simgrid::s4u::ActivitySet &pending, simgrid::s4u::Host *src, simgrid::s4u::Host *dst, double bytes)
+    {
+        while (pending.test_any()) // forget the flows that are over
+            ;
+        pending.push(simgrid::s4u::Comm::sendto_async(src, dst, bytes));
+        flows++;
+        offered_bytes += bytes;
+    }
+
+    /**
+     * @brief Body of the daemon actor of generator `index`.
+     *
+     * @param index
+     */
+    void run(size_t index)
+    {
+        const json &generator = generators[index];
+        std::string pattern = generator["pattern"].get<std::string>();
+        simgrid::s4u::ActivitySet pending;
+        if (pattern == "poisson")
+        {
+            std::exponential_distribution<double> interarrival(generator["rate"].get<double>());
+            while (true)
+            {
+                simgrid::s4u::this_actor::sleep_for(interarrival(gen));
+                std::pair<simgrid::s4u::Host *, simgrid::s4u::Host *> flow = endpoints(generator);
+                start(pending, flow.first, flow.second, generator["size"].get<double>());
+            }
+        }
+        else if (pattern == "onoff")
+        {
+            std::exponential_distribution<double> on(1.0 / generator["on"].get<double>());
+            std::exponential_distribution<double> off(1.0 / generator["off"].get<double>());
+            double size = generator["size"].get<double>();
+            while (true)
+            {
+                std::pair<simgrid::s4u::Host *, simgrid::s4u::Host *> flow = endpoints(generator);
+                double end = simgrid::s4u::Engine::get_clock() + on(gen);
+                while (simgrid::s4u::Engine::get_clock() < end)
+                {
+                    simgrid::s4u::Comm::sendto(flow.first, flow.second, size);
+                    flows++;
+                    offered_bytes += size;
+                }
+                simgrid::s4u::this_actor::sleep_for(off(gen));
+            }
+        }
+        else
+        {
+            for (const Flow &flow : traces[index])
+            {
+                simgrid::s4u::this_actor::sleep_until(flow.time);
+                start(pending, simgrid::s4u::Host::by_name(flow.src), simgrid::s4u::Host::by_name(flow.dst), flow.bytes);
+            }
+            pending.wait_all();
+        }
+    }
+
+    json summary() const
+    {
+        double now = simgrid::s4u::Engine::get_clock();
+        json result{{"flows", flows}, {"offered_bytes", offered_bytes}, {"offered_load", now > 0 ? offered_bytes / now : 0.0}};
+        if (baseline_time > 0) // only a run of the same configuration without background traffic gives the baseline
+            result["inflation"] = now / baseline_time;
+        return result;
+    }
+};
+
+// Created by main() when the configuration has a "background" section, driven by daemon actors.
+static BackgroundTraffic *background = nullptr;
@@ -10,8 +10,14 @@
 */
 
 #include <algorithm> // For std::sort
+#include <chrono>
 #include <fstream>
+#include <iostream>
+#include <functional>
+#include <limits>
 #include <map>
+#include <set>
+#include <sstream>
 #include <simgrid/s4u.hpp>
 #include <string>
 #include <unordered_map>
@@ -23,111 +29,153 @@
 
 XBT_LOG_NEW_DEFAULT_CATEGORY(APPFL_PDES, "Messages specific for this example");
 
-using json = nlohmann::json;
-
-json load_config(const char *config_arg)
+#include "FedCommon.hpp"
+
+// Server CPU time, in seconds at the server's speed, per assignment sent to a client and per update
+// received. The simulated server and the shadow predictor both charge them.
+static const double dispatch_overhead = 0.047;
+static const double processing_overhead = 0.15;
+
+/**
+ * @brief Shadow-mode predictor: follows the progress events of a live FedCompass run and predicts
+ * the arrivals over the current scheduling horizon (all assignments handed out so far).
+ *
+ * Rather than re-simulating, it uses the analytic fast tier. Per-client arrival estimates live in
+ * an ordered multiset and are updated incrementally, so each prediction costs O(log n). Transfers
+ * are sized by the payload schedule phase of the model's global step. Events are read line by line
+ * from a file or a pipe:
+ *   assign <time> <client> <steps> [step]  the global model of <step> (default: the last one given) was sent to the client with <steps> local steps
+ *   finish <time> <client> [seconds]    the client's update arrived, optionally with its observed time per step
+ *   speed <client> <seconds>            observed time per local step of a client
+ */
+class ShadowPredictor
 {
-    xbt_assert(config_arg != nullptr, "Missing JSON configuration argument");
-    std::ifstream file(config_arg);
-    if (file.good())
+public:
+    std::vector<double> step_time, download_latency, download_bandwidth, upload_latency, upload_bandwidth, assigned_at;
+    std::vector<long> assigned_round;
+    std::vector<int> assigned_steps;
+    std::vector<std::multiset<double>::iterator> handles;
+    std::multiset<double> estimates;
+    double model_size, last_event, momentum;
+    long round; // global step of the last assignment
+    int outstanding;
+
+    ShadowPredictor(const std::vector<double> &step_time, const std::vector<simgrid::s4u::Host *> &client_hosts,
+                    simgrid::s4u::Host *server_host, double model_size, double momentum)
     {
-        try
-        {
-            return json::parse(file);
-        }
-        catch (const json::parse_error &e)
+        this->step_time = step_time;
+        for (simgrid::s4u::Host *client_host : client_hosts)
         {
-            xbt_die("Failed to parse configuration file %s: %s", config_arg, e.what());
+            double latency = 0.0;
+            download_bandwidth.push_back(bottleneck_bandwidth(server_host, client_host, &latency));
+            download_latency.push_back(latency);
+            upload_bandwidth.push_back(bottleneck_bandwidth(client_host, server_host, &latency));
+            upload_latency.push_back(latency);
         }
+        this->model_size = model_size;
+        assigned_round.assign(step_time.size(), 0);
+        round = 0;
+        assigned_at.assign(step_time.size(), 0.0);
+        assigned_steps.assign(step_time.size(), 0); // 0: no outstanding assignment
+        handles.resize(step_time.size());
+        this->momentum = momentum;
+        last_event = 0.0;
+        outstanding = 0;
     }
 
-    try
+    double estimate(int client_idx) const
     {
-        return json::parse(config_arg);
+        long model_round = assigned_round[client_idx];
+        double download = transfer_time(download_latency[client_idx], download_bandwidth[client_idx], payload->bytes(model_size, model_round, false));
+        double upload = transfer_time(upload_latency[client_idx], upload_bandwidth[client_idx], payload->bytes(model_size, model_round, true));
+        return assigned_at[client_idx] + download + assigned_steps[client_idx] * step_time[client_idx] + upload + processing_overhead;
     }
-    catch (const json::parse_error &e)
+
+    void assign(int client_idx, double time, int steps)
     {
-        xbt_die("Failed to parse configuration JSON string: %s", e.what());
+        finish(client_idx, time);
+        assigned_at[client_idx] = time + dispatch_overhead;
+        assigned_round[client_idx] = round;
+        assigned_steps[client_idx] = steps;
+        handles[client_idx] = estimates.insert(estimate(client_idx));
+        outstanding++;
     }
-}
-
-std::unordered_map<int, double> parse_client_effects(const json &rules, int total_clients)
-{
-    std::unordered_map<int, double> effects;
-    if (rules.is_null())
-        return effects;
 
-    xbt_assert(rules.is_array(), "Straggler configuration must be a JSON array");
-
-    for (const auto &rule : rules)
+    void observe_speed(int client_idx, double seconds)
     {
-        xbt_assert(rule.contains("effect"), "Each straggler rule must define an \"effect\"");
-        double effect = rule["effect"].get<double>();
-        xbt_assert(effect > 0.0, "Straggler effect must be positive (got %f)", effect);
-
-        bool applied = false;
-        auto apply_to_client = [&](int client_id) {
-            xbt_assert(client_id >= 0 && client_id < total_clients, "Invalid straggler client %d (valid range: 0-%d)", client_id, total_clients - 1);
-            applied = true;
-            auto it = effects.find(client_id);
-            if (it == effects.end())
-            {
-                effects[client_id] = effect;
-            }
-            else
-            {
-                it->second *= effect;
-            }
-        };
+        step_time[client_idx] = (1.0 - momentum) * step_time[client_idx] + momentum * seconds;
+        if (assigned_steps[client_idx] == 0)
+            return;
+        estimates.erase(handles[client_idx]);
+        handles[client_idx] = estimates.insert(estimate(client_idx));
+    }
 
-        if (rule.contains("client"))
-        {
-            xbt_assert(rule["client"].is_number_integer(), "\"client\" must be an integer");
-            apply_to_client(rule["client"].get<int>());
-        }
+    void finish(int client_idx, double time)
+    {
+        last_event = std::max(last_event, time);
+        if (assigned_steps[client_idx] == 0)
+            return;
+        estimates.erase(handles[client_idx]);
+        assigned_steps[client_idx] = 0;
+        outstanding--;
+    }
 
-        if (rule.contains("clients"))
+    void follow(const std::string &events_path, std::ostream &out)
+    {
+        std::ifstream events(events_path);
+        xbt_assert(events.good(), "Cannot open shadow event stream %s", events_path.c_str());
+        std::string line;
+        while (std::getline(events, line))
         {
-            xbt_assert(rule["clients"].is_array(), "\"clients\" must be an array of integers");
-            for (const auto &client_val : rule["clients"])
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind) || kind[0] == '#')
+                continue;
+            auto begin = std::chrono::steady_clock::now();
+            double time = last_event;
+            int client_idx = -1;
+            if (kind == "assign")
             {
-                xbt_assert(client_val.is_number_integer(), "Each entry in \"clients\" must be an integer");
-                apply_to_client(client_val.get<int>());
+                int steps = 0;
+                fields >> time >> client_idx >> steps;
+                xbt_assert(client_idx >= 0 && client_idx < static_cast<int>(step_time.size()) && steps > 0, "Invalid shadow event: %s", line.c_str());
+                long model_round = -1;
+                if (fields >> model_round)
+                {
+                    xbt_assert(model_round >= 0, "Invalid global step in shadow event: %s", line.c_str());
+                    round = model_round;
+                }
+                assign(client_idx, time, steps);
             }
-        }
-
-        if (rule.contains("range"))
-        {
-            const auto &range_val = rule["range"];
-            int start_client = 0;
-            int end_client = 0;
-            if (range_val.is_array())
+            else if (kind == "finish")
             {
-                xbt_assert(range_val.size() == 2, "\"range\" array must contain exactly two integers");
-                xbt_assert(range_val[0].is_number_integer() && range_val[1].is_number_integer(), "\"range\" entries must be integers");
-                start_client = range_val[0].get<int>();
-                end_client = range_val[1].get<int>();
+                double seconds = -1.0;
+                fields >> time >> client_idx >> seconds;
+                xbt_assert(client_idx >= 0 && client_idx < static_cast<int>(step_time.size()), "Invalid client in shadow event: %s", line.c_str());
+                if (seconds > 0)
+                    observe_speed(client_idx, seconds);
+                finish(client_idx, time);
             }
-            else
+            else if (kind == "speed")
             {
-                xbt_assert(range_val.is_object(), "\"range\" must be an object or a two-value array");
-                xbt_assert(range_val.contains("start") && range_val.contains("end"), "\"range\" object must contain \"start\" and \"end\"");
-                xbt_assert(range_val["start"].is_number_integer() && range_val["end"].is_number_integer(), "\"start\" and \"end\" must be integers");
-                start_client = range_val["start"].get<int>();
-                end_client = range_val["end"].get<int>();
+                double seconds = -1.0;
+                fields >> client_idx >> seconds;
+                xbt_assert(client_idx >= 0 && client_idx < static_cast<int>(step_time.size()) && seconds > 0, "Invalid shadow event: %s", line.c_str());
+                observe_speed(client_idx, seconds);
             }
-            xbt_assert(start_client <= end_client, "\"range\" start must be <= end");
-            for (int client = start_client; client <= end_client; ++client)
+            else
             {
-                apply_to_client(client);
+                XBT_WARN("Ignoring unknown shadow event: %s", line.c_str());
+                continue;
             }
+            double next_arrival = estimates.empty() ? last_event : std::max(last_event, *estimates.begin());
+            double horizon_end = estimates.empty() ? last_event : std::max(last_event, *estimates.rbegin());
+            double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+            // <event time> <predicted next arrival> <predicted horizon completion> <outstanding clients> <prediction cost in us>
+            out << time << " " << next_arrival << " " << horizon_end << " " << outstanding << " " << micros << std::endl;
         }
-
-        xbt_assert(applied, "Straggler rule must target at least one client");
     }
-
-    return effects;
-}
+};
 
 template <typename T, typename... Args>
 void delayed_action(double delay_in_seconds, void (T::*member_func)(Args...), T *object, Args... args)
@@ -142,32 +190,46 @@ void delayed_action(double delay_in_seconds, void (T::*member_func)(Args...), T
     (object->*member_func)(args...);
 }
 
+// Created by main() before the actors, used by the clients around each exchange with the server.
+static ClientPipeline *pipeline = nullptr;
+
+// Created by main() before the actors, shared by the server, the clients and the population manager.
+static Population *population = nullptr;
+
 class ServerFedCompass
 {
 public:
     int counter, global_step, general_buffer_size;
+    double model_size, general_buffer_bytes;
     std::map<int, int> step;
     std::map<int, int> group_pseudo_grad; // key: group_idx, value: _counter
+    std::map<int, double> group_bytes;    // key: group_idx, value: received bytes held for the group
 
     // simgrid s4u properties
     simgrid::s4u::Host *host;
     double host_speed;
 
-    ServerFedCompass(int num_clients)
+    ServerFedCompass(int num_clients, double model_size)
     {
         counter = 0;
         global_step = 0;
         general_buffer_size = 0;
+        general_buffer_bytes = 0.0;
+        this->model_size = model_size;
 
         // initilization of s4u properties:
         this->host = simgrid::s4u::this_actor::get_host();
         this->host_speed = host->get_speed();
     }
 
-    void update()
+    /**
+     * @brief Update the model with a local model of `bytes` as received.
+     */
+    void update(double bytes)
     {
         simgrid::s4u::this_actor::execute(0.03 * host_speed); // aggregation cost per client
         global_step += 1;
+        server_memory->release(bytes);
     }
 
     /**
@@ -176,21 +238,24 @@ public:
      * @param init_step
      * @param client_idx
      * @param group_idx
+     * @param bytes size of the local model as received
      */
-    void buffer(int init_step, int client_idx, int group_idx)
+    void buffer(int init_step, int client_idx, int group_idx, double bytes)
     {
-        if (group_pseudo_grad.find(group_idx) != group_pseudo_grad.end())
+        if (group_pseudo_grad.find(group_idx) == group_pseudo_grad.end())
         {
             group_pseudo_grad[group_idx] = 0;
         }
         simgrid::s4u::this_actor::execute(0.01 * host_speed); // TODO
         group_pseudo_grad[group_idx]++;
+        group_bytes[group_idx] += bytes;
     }
 
-    void single_buffer(int client_idx)
+    void single_buffer(int client_idx, double bytes)
     {
         simgrid::s4u::this_actor::execute(0.01 * host_speed); // TODO
         general_buffer_size++;
+        general_buffer_bytes += bytes;
     }
 
     /**
@@ -200,12 +265,16 @@ public:
      */
     void update_group(int group_idx)
     {
-        if (group_pseudo_grad.find(group_idx) == group_pseudo_grad.end())
+        if (group_pseudo_grad.find(group_idx) != group_pseudo_grad.end())
         {
             simgrid::s4u::this_actor::execute(0.01 * host_speed); // TODO
             global_step++;
+            // the group buffer and the general buffer are both folded into the global model
+            server_memory->release(group_bytes[group_idx] + general_buffer_bytes);
             general_buffer_size = 0;
+            general_buffer_bytes = 0.0;
             group_pseudo_grad.erase(group_idx);
+            group_bytes.erase(group_idx);
         }
     }
 
@@ -213,14 +282,26 @@ public:
     {
         simgrid::s4u::this_actor::execute(0.0 * host_speed); // TODO
         global_step++;
+        server_memory->release(general_buffer_bytes);
+        general_buffer_size = 0;
+        general_buffer_bytes = 0.0;
     }
 };
 
+// Local model upload. The timestamps let the scheduler tell local training from communication.
+struct LocalUpdate
+{
+    int client_idx;
+    double received_at; // the client got the global model
+    double trained_at;  // the client finished local training
+    double bytes;       // size of the upload, after the payload schedule
+};
+
 class ClientInfo
 {
 public:
     int step, local_steps, goa, total_steps;
-    double speed, start_time;
+    double speed, start_time, comm_time, expected_arrival, latest_arrival;
 
     ClientInfo()
     {
@@ -230,6 +311,9 @@ public:
         goa = -1;
         speed = -1.0;
         start_time = 0.0;
+        comm_time = 0.0;
+        expected_arrival = 0.0;
+        latest_arrival = 0.0;
     }
 };
 
@@ -246,13 +330,104 @@ public:
     }
 };
 
+/**
+ * @brief Online tuning of the latest-arrival factor lambda.
+ *
+ * Every `window` arrivals, lambda grows by `step` (relative) when more than `target_late_fraction`
+ * of the clients missed the latest arrival time of their group, and shrinks by half a step otherwise
+ * so that groups do not wait longer than needed. Lambda stays within [`min`, `max`]. With a fixed
+ * lambda the tuner only records the timeline.
+ */
+class LambdaTuner
+{
+public:
+    bool adaptive;
+    double lambda, min_lambda, max_lambda, target_late_fraction, step;
+    long window, arrivals, late_arrivals, groups, grouped_clients;
+    json timeline;
+
+    LambdaTuner(const json &lambda_adaptive, double lambda)
+    {
+        // "lambda_adaptive": true enables the tuner with the default settings
+        xbt_assert(lambda_adaptive.is_boolean() || lambda_adaptive.is_object(), "\"lambda_adaptive\" must be a boolean or an object");
+        json settings = lambda_adaptive.is_object() ? lambda_adaptive : json::object();
+        adaptive = lambda_adaptive.is_boolean() ? lambda_adaptive.get<bool>() : !settings.empty();
+        this->lambda = lambda;
+        min_lambda = settings.value("min", 1.0);
+        max_lambda = settings.value("max", 3.0);
+        target_late_fraction = settings.value("target_late_fraction", 0.1);
+        step = settings.value("step", 0.1);
+        window = settings.value("window", 20L);
+        xbt_assert(min_lambda >= 1.0 && min_lambda <= max_lambda, "Adaptive lambda needs 1 <= min <= max");
+        xbt_assert(step > 0 && step < 1 && window > 0, "Adaptive lambda needs 0 < step < 1 and a positive window");
+        if (adaptive)
+            this->lambda = std::min(std::max(lambda, min_lambda), max_lambda);
+        arrivals = 0;
+        late_arrivals = 0;
+        groups = 0;
+        grouped_clients = 0;
+        timeline = json::array();
+    }
+
+    /**
+     * @brief A group was aggregated with `size` clients (late arrivals count as groups of one).
+     *
+     * @param size
+     */
+    void group(int size)
+    {
+        groups++;
+        grouped_clients += size;
+    }
+
+    /**
+     * @brief Count an arrival and, at the end of a window, retune lambda.
+     *
+     * @param late the client arrived after the latest arrival time of its group
+     * @return true if lambda changed
+     */
+    bool arrival(bool late)
+    {
+        arrivals++;
+        late_arrivals += late;
+        if (arrivals < window)
+            return false;
+        double late_fraction = static_cast<double>(late_arrivals) / arrivals;
+        double mean_group_size = groups > 0 ? static_cast<double>(grouped_clients) / groups : 0.0;
+        // [time, lambda, mean group size, late fraction] over the window
+        timeline.push_back(json{simgrid::s4u::Engine::get_clock(), lambda, mean_group_size, late_fraction});
+        double previous = lambda;
+        if (adaptive)
+        {
+            lambda *= late_fraction > target_late_fraction ? 1.0 + step : 1.0 - step / 2;
+            lambda = std::min(std::max(lambda, min_lambda), max_lambda);
+        }
+        arrivals = 0;
+        late_arrivals = 0;
+        groups = 0;
+        grouped_clients = 0;
+        return lambda != previous;
+    }
+
+    json summary() const
+    {
+        return json{{"adaptive", adaptive}, {"final", lambda}, {"timeline", timeline}};
+    }
+};
+
 class SchedulerCompass
 {
 public:
     int iter, num_clients, num_global_epochs, group_counter, max_local_steps, min_local_steps, max_local_steps_bound;
     double SPEED_MOMENTUM, LATEST_TIME_FACTOR, start_time;
+    bool bandwidth_aware;
+    LambdaTuner *lambda_tuner;
+    LocalUpdate last_update;
+    long arrivals, late_arrivals;
+    double lateness_sum, abs_lateness_sum;
     ServerFedCompass *server;
     std::vector<ClientInfo *> client_info;
+    std::vector<double> join_time; // when each client slot was (re)filled, relative to start_time
     std::map<int, GOA *> group_of_arrival;
     std::unordered_set<int> &pending_clients;
 
@@ -262,7 +437,7 @@ public:
     int model_size;
     std::vector<simgrid::s4u::Mailbox *> mailboxes;
 
-    SchedulerCompass(int max_local_steps, int num_clients, int num_global_epochs, int model_size, const std::vector<simgrid::s4u::Mailbox *> &mailboxes, std::unordered_set<int> &pending_clients, double q_ratio = 0.2, double lambda_val = 1.5) : pending_clients(pending_clients)
+    SchedulerCompass(int max_local_steps, int num_clients, int num_global_epochs, int model_size, const std::vector<simgrid::s4u::Mailbox *> &mailboxes, std::unordered_set<int> &pending_clients, double q_ratio = 0.2, double lambda_val = 1.5, bool bandwidth_aware = false, const json &lambda_settings = json::object()) : pending_clients(pending_clients)
     {
         this->iter = 0;
         this->num_clients = num_clients;
@@ -272,13 +447,21 @@ public:
         this->min_local_steps = std::max(static_cast<int>(q_ratio * this->max_local_steps), 1);
         this->max_local_steps_bound = static_cast<int>(1.2 * this->max_local_steps);
         this->SPEED_MOMENTUM = 0.9;
-        this->LATEST_TIME_FACTOR = lambda_val;
+        this->lambda_tuner = new LambdaTuner(lambda_settings, lambda_val);
+        this->LATEST_TIME_FACTOR = lambda_tuner->lambda;
+        this->bandwidth_aware = bandwidth_aware;
+        this->last_update = LocalUpdate{-1, 0.0, 0.0, 0.0};
+        this->arrivals = 0;
+        this->late_arrivals = 0;
+        this->lateness_sum = 0.0;
+        this->abs_lateness_sum = 0.0;
         this->start_time = simgrid::s4u::Engine::get_clock();
-        this->server = new ServerFedCompass(num_clients);
+        this->server = new ServerFedCompass(num_clients, model_size);
         for (int i = 0; i < num_clients; i++)
         {
             this->client_info.push_back(nullptr);
         }
+        this->join_time.assign(num_clients, 0.0);
 
         // initilization of s4u properties:
         this->host = simgrid::s4u::this_actor::get_host();
@@ -287,33 +470,118 @@ public:
         this->mailboxes = mailboxes;
     }
 
+    /**
+     * @brief Update the speed estimate of the client that just arrived.
+     *
+     * Without bandwidth awareness, the whole round trip is charged to the local steps. Otherwise the
+     * training time comes from the upload timestamps and the rest of the round trip (download, upload,
+     * queueing at the server) is kept as a fixed communication term that does not scale with the steps.
+     *
+     * @param client_idx
+     */
     void _record_info(int client_idx)
     {
         double curr_time = simgrid::s4u::Engine::get_clock() - start_time;
-        double local_start_time = client_info[client_idx] == nullptr ? 0.0 : client_info[client_idx]->start_time;
+        double local_start_time = client_info[client_idx] == nullptr ? join_time[client_idx] : client_info[client_idx]->start_time;
         double local_update_time = curr_time - local_start_time;
         int local_steps = client_info[client_idx] == nullptr ? max_local_steps : client_info[client_idx]->local_steps;
-        double local_speed = local_update_time / local_steps;
+        double compute_time = bandwidth_aware ? last_update.trained_at - last_update.received_at : local_update_time;
+        double comm_time = std::max(0.0, local_update_time - compute_time);
+        double local_speed = compute_time / local_steps;
         if (!client_info[client_idx])
         {
             client_info[client_idx] = new ClientInfo();
             client_info[client_idx]->speed = local_speed;
+            client_info[client_idx]->comm_time = comm_time;
             client_info[client_idx]->step = 0;
             client_info[client_idx]->total_steps = min_local_steps;
         }
         else
         {
+            // lateness against the deadline of the group the client was assigned to
+            double lateness = curr_time - client_info[client_idx]->expected_arrival;
+            bool late = curr_time >= client_info[client_idx]->latest_arrival;
+            arrivals++;
+            late_arrivals += late;
+            if (lambda_tuner->arrival(late))
+            {
+                LATEST_TIME_FACTOR = lambda_tuner->lambda;
+                XBT_INFO("[Scheduler]: lambda set to %f", LATEST_TIME_FACTOR);
+            }
+            lateness_sum += lateness;
+            abs_lateness_sum += std::abs(lateness);
             client_info[client_idx]->speed = (1.0 - SPEED_MOMENTUM) * client_info[client_idx]->speed + SPEED_MOMENTUM * local_speed;
+            client_info[client_idx]->comm_time = (1.0 - SPEED_MOMENTUM) * client_info[client_idx]->comm_time + SPEED_MOMENTUM * comm_time;
         }
     }
 
+    /**
+     * @brief Record the group the client trains for and its deadlines.
+     */
+    void _set_assignment(int client_idx, int group_idx, int local_steps, double curr_time)
+    {
+        client_info[client_idx]->goa = group_idx;
+        client_info[client_idx]->local_steps = local_steps;
+        client_info[client_idx]->start_time = curr_time;
+        client_info[client_idx]->expected_arrival = group_of_arrival[group_idx]->expected_arrival_time;
+        client_info[client_idx]->latest_arrival = group_of_arrival[group_idx]->latest_arrival_time;
+    }
+
+    json lateness_summary() const
+    {
+        return json{{"bandwidth_aware", bandwidth_aware}, {"arrivals", arrivals},
+                    {"mean_lateness", arrivals > 0 ? lateness_sum / arrivals : 0.0},
+                    {"mean_abs_lateness", arrivals > 0 ? abs_lateness_sum / arrivals : 0.0},
+                    {"late_fraction", arrivals > 0 ? static_cast<double>(late_arrivals) / arrivals : 0.0}};
+    }
+
+    /**
+     * @brief Register a client that joined mid-run. Its ClientInfo is created on its first arrival.
+     *
+     * @param client_idx
+     */
+    void admit(int client_idx)
+    {
+        join_time[client_idx] = simgrid::s4u::Engine::get_clock() - start_time;
+        delete client_info[client_idx]; // left over by the client that last held the slot
+        client_info[client_idx] = nullptr;
+        pending_clients.insert(client_idx);
+    }
+
+    /**
+     * @brief Send the termination signal instead of a new model if the client is leaving.
+     *
+     * @param client_idx
+     * @return true if the client has been retired
+     */
+    bool _retire_if_leaving(int client_idx)
+    {
+        if (!population->leaving(client_idx))
+            return false;
+        for (auto &group : group_of_arrival)
+        {
+            std::vector<int> &arrived = group.second->arrived_clients;
+            arrived.erase(std::remove(arrived.begin(), arrived.end(), client_idx), arrived.end());
+        }
+        control_plane->send(client_idx, ServerMessage::TERMINATE);
+        delete client_info[client_idx];
+        client_info[client_idx] = nullptr;
+        population->retire(client_idx);
+        return true;
+    }
+
     int _recv_local_model_from_client()
     {
-        int* client_idx = mailboxes[num_clients]->get<int>(); // the value got will be discarded since it will be just a signal
-        simgrid::s4u::this_actor::execute(0.15 * host_speed);
-        pending_clients.erase(*client_idx);
-        XBT_INFO("Step 4.%04d: Received local model from Client %d. Current pending clients: %ld", *client_idx, *client_idx, pending_clients.size());
-        return *client_idx;
+        LocalUpdate *local_update = mailboxes[num_clients]->get<LocalUpdate>();
+        latency->arrived(local_update->client_idx);
+        last_update = *local_update;
+        delete local_update;
+        int client_idx = last_update.client_idx;
+        server_memory->spill();
+        simgrid::s4u::this_actor::execute(processing_overhead * host_speed);
+        pending_clients.erase(client_idx);
+        XBT_INFO("Step 4.%04d: Received local model from Client %d. Current pending clients: %ld", client_idx, client_idx, pending_clients.size());
+        return client_idx;
     }
 
     bool _join_group(int client_idx)
@@ -323,7 +591,7 @@ public:
         int assigned_steps = -1; // assigned local training steps for the client
         for (auto &group : group_of_arrival)
         {
-            double remaining_time = group.second->expected_arrival_time - curr_time;
+            double remaining_time = group.second->expected_arrival_time - curr_time - client_info[client_idx]->comm_time;
             int local_steps = static_cast<int>(remaining_time / client_info[client_idx]->speed);
             if (local_steps < min_local_steps || local_steps < assigned_steps || local_steps > max_local_steps_bound)
             {
@@ -337,9 +605,7 @@ public:
         }
         if (assigned_group != -1)
         {
-            client_info[client_idx]->goa = assigned_group;
-            client_info[client_idx]->local_steps = assigned_steps;
-            client_info[client_idx]->start_time = curr_time;
+            _set_assignment(client_idx, assigned_group, assigned_steps, curr_time);
             group_of_arrival[assigned_group]->clients.push_back(client_idx);
             XBT_INFO("Client %d - Join GOA %d - Local step %d, At time %f", client_idx, assigned_group, assigned_steps, curr_time);
             return true;
@@ -350,6 +616,36 @@ public:
         }
     }
 
+    /**
+     * @brief Open a group for the client alone and schedule its aggregation at the latest arrival time.
+     *
+     * @param client_idx
+     * @param local_steps
+     * @param curr_time
+     */
+    void _new_group(int client_idx, int local_steps, double curr_time)
+    {
+        int group_idx = group_counter;
+        double training_time = local_steps * client_info[client_idx]->speed;
+        group_of_arrival[group_idx] = new GOA();
+        group_of_arrival[group_idx]->clients.push_back(client_idx);
+        group_of_arrival[group_idx]->expected_arrival_time = curr_time + client_info[client_idx]->comm_time + training_time;
+        group_of_arrival[group_idx]->latest_arrival_time = curr_time + client_info[client_idx]->comm_time + training_time * LATEST_TIME_FACTOR;
+
+        XBT_INFO("Group %d created at %f with expected arrival time: %f", group_idx, curr_time, group_of_arrival[group_idx]->expected_arrival_time);
+        XBT_INFO("Client %d joined group %d at time %f", client_idx, group_idx, curr_time);
+
+        double delay = group_of_arrival[group_idx]->latest_arrival_time - curr_time;
+        auto group_aggregation_lambda = [this, delay, group_idx]()
+        {
+            delayed_action(delay, &SchedulerCompass::_group_aggregation, this, group_idx);
+        };
+        simgrid::s4u::Actor::create("group_aggregation_actor_" + std::to_string(group_idx), simgrid::s4u::this_actor::get_host(), group_aggregation_lambda);
+        _set_assignment(client_idx, group_idx, local_steps, curr_time);
+        XBT_INFO("Client %d - Create GOA %d - Local steps %d - At time %f", client_idx, group_idx, local_steps, curr_time);
+        group_counter++;
+    }
+
     void _create_group(int client_idx)
     {
         double curr_time = simgrid::s4u::Engine::get_clock() - start_time;
@@ -359,15 +655,21 @@ public:
             if (curr_time < group.second->latest_arrival_time)
             {
                 double fastest_speed = std::numeric_limits<double>::infinity();
+                double fastest_comm_time = 0.0;
                 std::vector<int> group_clients;
                 group_clients.insert(group_clients.end(), group.second->clients.begin(), group.second->clients.end());
                 group_clients.insert(group_clients.end(), group.second->arrived_clients.begin(), group.second->arrived_clients.end());
                 for (int client : group_clients)
                 {
-                    fastest_speed = std::min(fastest_speed, client_info[client]->speed);
+                    if (client_info[client]->speed < fastest_speed)
+                    {
+                        fastest_speed = client_info[client]->speed;
+                        fastest_comm_time = client_info[client]->comm_time;
+                    }
                 }
-                double est_arrival_time = group.second->latest_arrival_time + fastest_speed * max_local_steps;
-                int local_steps = static_cast<int>(est_arrival_time - curr_time) / client_info[client_idx]->speed;
+                // the fastest client's next round trip, transfers included as in _new_group()
+                double est_arrival_time = group.second->latest_arrival_time + fastest_comm_time + fastest_speed * max_local_steps;
+                int local_steps = static_cast<int>((est_arrival_time - curr_time - client_info[client_idx]->comm_time) / client_info[client_idx]->speed);
                 if (local_steps <= max_local_steps)
                 {
                     assigned_steps = std::max(assigned_steps, local_steps);
@@ -378,32 +680,17 @@ public:
         assigned_steps = (assigned_steps < 0) ? max_local_steps : assigned_steps;
 
         // Create a group for the client
-        group_of_arrival[group_counter] = new GOA();
-        group_of_arrival[group_counter]->clients.push_back(client_idx);
-        group_of_arrival[group_counter]->expected_arrival_time = curr_time + assigned_steps * client_info[client_idx]->speed;
-        group_of_arrival[group_counter]->latest_arrival_time = curr_time + assigned_steps * client_info[client_idx]->speed * LATEST_TIME_FACTOR;
-
-        XBT_INFO("Group %d created at %f with expected arrival time: %f", group_counter, curr_time, group_of_arrival[group_counter]->expected_arrival_time);
-        XBT_INFO("Client %d joined group %d at time %f", client_idx, group_counter, curr_time);
-
-        auto group_aggregation_lambda = [this, curr_time]()
-        {
-            XBT_INFO("Delayed action in create_group");
-            delayed_action(group_of_arrival[group_counter]->latest_arrival_time - curr_time, &SchedulerCompass::_group_aggregation, this, group_counter);
-        };
-        simgrid::s4u::Actor::create("group_aggregation_actor_" + std::to_string(group_counter), simgrid::s4u::this_actor::get_host(), group_aggregation_lambda);
-        client_info[client_idx]->goa = group_counter;
-        client_info[client_idx]->local_steps = assigned_steps;
-        client_info[client_idx]->start_time = curr_time;
-        XBT_INFO("Client %d - Create GOA %d - Local steps %d - At time %f", client_idx, group_counter, assigned_steps, curr_time);
-        group_counter++;
+        _new_group(client_idx, assigned_steps, curr_time);
     }
 
     void _send_global_model_to_client(int client_idx, int client_steps)
     {
         XBT_INFO("New global model generated, now sending the new model to Client %d with %d step size", client_idx, client_steps);
-        mailboxes[client_idx]->put(new int(client_steps), model_size);
-        simgrid::s4u::this_actor::execute(0.047 * host_speed);
+        payload->round = server->global_step;
+        intra_node->charge(client_idx, payload->bytes(model_size, payload->round, false));
+        payload->put(mailboxes[client_idx], control_plane->model(model_size, payload->round, client_steps), model_size, payload->round, false);
+        latency->sent(client_idx);
+        simgrid::s4u::this_actor::execute(dispatch_overhead * host_speed);
         pending_clients.insert(client_idx);
         XBT_INFO("Step 1.%04d: New global model sent, starting next epoch. Current pending clients: %ld", client_idx, pending_clients.size());
     }
@@ -420,6 +707,7 @@ public:
     {
         if (group_of_arrival.find(group_idx) != group_of_arrival.end())
         {
+            lambda_tuner->group(static_cast<int>(group_of_arrival[group_idx]->arrived_clients.size()));
             server->update_group(group_idx);
             std::vector<std::pair<int, double>> client_speed;
             for (auto &client : group_of_arrival[group_idx]->arrived_clients)
@@ -434,9 +722,13 @@ public:
                       });
             group_of_arrival[group_idx]->expected_arrival_time = 0.0;
             group_of_arrival[group_idx]->latest_arrival_time = 0.0;
+            std::vector<int> staying_clients;
             for (auto &client : client_speed)
             {
+                if (_retire_if_leaving(client.first))
+                    continue;
                 _assign_group(client.first);
+                staying_clients.push_back(client.first);
             }
             // delete the group is not waiting any client
             if (group_of_arrival[group_idx]->clients.size() == 0)
@@ -447,9 +739,9 @@ public:
             }
             if (iter < num_global_epochs)
             {
-                for (auto &client : client_speed)
+                for (int client : staying_clients)
                 {
-                    _send_model(client.first);
+                    _send_model(client);
                 }
             }
             else
@@ -469,23 +761,7 @@ public:
         double curr_time = simgrid::s4u::Engine::get_clock() - start_time;
         if (!group_of_arrival.size())
         {
-            group_of_arrival[group_counter] = new GOA();
-            group_of_arrival[group_counter]->clients.push_back(client_idx);
-            group_of_arrival[group_counter]->expected_arrival_time = curr_time + max_local_steps * client_info[client_idx]->speed;
-            group_of_arrival[group_counter]->latest_arrival_time = curr_time + client_info[client_idx]->speed * LATEST_TIME_FACTOR;
-            XBT_INFO("Group %d created at %f with expected arrival time %f", group_counter, curr_time, group_of_arrival[group_counter]->expected_arrival_time);
-            XBT_INFO("Client %d joined group %d at time %f", client_idx, group_counter, curr_time);
-            auto group_aggregation_lambda = [this, curr_time]()
-            {
-                XBT_INFO("Delayed action in assign_group");
-                delayed_action(group_of_arrival[group_counter]->latest_arrival_time - curr_time, &SchedulerCompass::_group_aggregation, this, group_counter);
-            };
-            simgrid::s4u::Actor::create("group_aggregation_actor_" + std::to_string(group_counter), simgrid::s4u::this_actor::get_host(), group_aggregation_lambda);
-            client_info[client_idx]->goa = group_counter;
-            client_info[client_idx]->local_steps = max_local_steps;
-            client_info[client_idx]->start_time = curr_time;
-            XBT_INFO("Client %d - Create GOA %d - Local steps %d - At time %f", client_idx, group_counter, max_local_steps, curr_time);
-            group_counter++;
+            _new_group(client_idx, max_local_steps, curr_time);
         }
         else
         {
@@ -506,11 +782,15 @@ public:
     {
         if (buffer)
         {
-            server->single_buffer(client_idx);
+            server->single_buffer(client_idx, last_update.bytes);
         }
         else
         {
-            server->update();
+            server->update(last_update.bytes);
+        }
+        if (_retire_if_leaving(client_idx))
+        {
+            return;
         }
         client_info[client_idx]->step = server->global_step;
         _assign_group(client_idx);
@@ -536,6 +816,7 @@ public:
                 group_of_arrival.erase(group_idx);
                 XBT_INFO("Client %d arrived (late) at group %d at time %f", client_idx, group_idx, curr_time);
             }
+            lambda_tuner->group(1);
             _single_update(client_idx, true);
         }
         else
@@ -543,7 +824,7 @@ public:
             group_of_arrival[group_idx]->clients.erase(std::remove(group_of_arrival[group_idx]->clients.begin(), group_of_arrival[group_idx]->clients.end(), client_idx));
             group_of_arrival[group_idx]->arrived_clients.push_back(client_idx);
             XBT_INFO("Client %d arrived at group %d at time %f", client_idx, group_idx, curr_time);
-            server->buffer(client_info[client_idx]->step, client_idx, group_idx);
+            server->buffer(client_info[client_idx]->step, client_idx, group_idx, last_update.bytes);
             if (group_of_arrival[group_idx]->clients.size() == 0)
             {
                 _group_aggregation(group_idx);
@@ -570,12 +851,13 @@ public:
         int client_idx = _recv_local_model_from_client();
         _record_info(client_idx);
         _update(client_idx);
+        population->updates++;
     }
 };
 
 static void server(std::vector<std::string> args)
 {
-    xbt_assert(args.size() >= 10, "The server function expects at least 10 arguments");
+    xbt_assert(args.size() >= 16, "The server function expects at least 16 arguments");
 
     int num_clients = std::stoi(args[0]);
     long num_epochs = std::stol(args[1]);
@@ -587,6 +869,12 @@ static void server(std::vector<std::string> args)
     double validation_cost = std::stod(args[7]);
     double model_size = std::stod(args[8]);
     bool validation_flag = std::stoi(args[9]);
+    json checkpoint_settings = json::parse(args[10]);
+    long validation_interval = std::stol(args[11]);
+    std::string validation_mode = args[12];
+    json memory_settings = json::parse(args[13]);
+    bool bandwidth_aware = std::stoi(args[14]);
+    json lambda_settings = json::parse(args[15]);
     std::unordered_set<int> pending_clients;
 
     simgrid::s4u::Host *host = simgrid::s4u::this_actor::get_host();
@@ -604,19 +892,40 @@ static void server(std::vector<std::string> args)
 
     simgrid::s4u::this_actor::execute(dataloader_cost * host_speed); // simulate dataload and partitioning
 
+    Checkpointer checkpointer(checkpoint_settings, model_size);
+    Validator validator(validation_flag, validation_cost, validation_interval, validation_mode);
+    server_memory = new ServerMemory(memory_settings);
+
     // broadcast global model to client
     for (size_t i = 0; i < num_clients; i++)
     {
+        if (!population->present(i))
+            continue;
         XBT_INFO("Broadcasting global model size and model to client %zu", i);
-        mailboxes[i]->put(new int(model_size), 4); // model size
-        mailboxes[i]->put(new int(max_local_steps), model_size);
-        simgrid::s4u::this_actor::execute(0.047 * host_speed);
+        intra_node->charge(i, payload->bytes(model_size, 0, false));
+        payload->put(mailboxes[i], control_plane->model(model_size, 0, max_local_steps), model_size, 0, false);
+        latency->sent(i);
+        simgrid::s4u::this_actor::execute(dispatch_overhead * host_speed);
         XBT_INFO("Step 1.%04ld: Broadcast global model to client %ld", i, i);
         pending_clients.insert(i);
     }
 
     // Obtain the scheduler
-    SchedulerCompass *scheduler = new SchedulerCompass(max_local_steps, num_clients, num_epochs, model_size, mailboxes, pending_clients, q_ratio, lambda_val);
+    SchedulerCompass *scheduler = new SchedulerCompass(max_local_steps, num_clients, num_epochs, model_size, mailboxes, pending_clients, q_ratio, lambda_val, bandwidth_aware, lambda_settings);
+
+    // clients joining later get the current global model with the default number of local steps
+    population->onboard = [scheduler, mailboxes, model_size, max_local_steps, host_speed](int client_idx) {
+        if (population->closed)
+            return; // the run ended while the client was starting up: the server terminates every present slot
+        scheduler->admit(client_idx);
+        payload->round = scheduler->server->global_step;
+        intra_node->charge(client_idx, payload->bytes(model_size, payload->round, false));
+        payload->put(mailboxes[client_idx], control_plane->model(model_size, payload->round, max_local_steps), model_size, payload->round, false);
+        latency->sent(client_idx);
+        simgrid::s4u::this_actor::execute(dispatch_overhead * host_speed);
+        XBT_INFO("Step 1.%04d: Onboarded new client %d", client_idx, client_idx);
+    };
+    population->opened->release();
 
     int global_step = 0;
     while (true)
@@ -624,45 +933,61 @@ static void server(std::vector<std::string> args)
         XBT_INFO("Starting epoch %d of %ld", global_step + 1, num_epochs);
         scheduler->update();
         global_step++;
-        if (validation_flag || global_step == num_epochs)
+        progress = global_step;
+        checkpointer.step(global_step);
+        validator.step(global_step);
+        if (global_step == num_epochs)
         {
-            simgrid::s4u::this_actor::execute(0.1 * host_speed); // TODO: Measure validation workloads
-            if (global_step == num_epochs)
-            {
-                break;
-            }
+            // the final model is always validated
+            if (!validator.enabled || global_step % validator.interval != 0)
+                validator.run(false);
+            break;
         }
     }
+    population->closed = true;
     XBT_INFO("All rounds have been completed. Requesting all clients to stop. Current pending clients at server is %ld", pending_clients.size());
     while(!pending_clients.empty())
     {
-        int *client_id = mailboxes[num_clients]->get<int>();
-        simgrid::s4u::this_actor::execute(0.15 * host_speed);
-        int temp = *client_id;
+        LocalUpdate *local_update = mailboxes[num_clients]->get<LocalUpdate>();
+        latency->arrived(local_update->client_idx);
+        simgrid::s4u::this_actor::execute(processing_overhead * host_speed);
+        int temp = local_update->client_idx;
+        server_memory->release(local_update->bytes); // late update is dropped
+        delete local_update;
         XBT_INFO("Step 5.%04d: Received client %d in cleanup", temp, temp);
-        pending_clients.erase(*client_id);
+        pending_clients.erase(temp);
     }
     for(int i = 0; i < num_clients; i++){
-        mailboxes[i]->put(new int(-1), 0);
+        if (!population->present(i))
+            continue;
+        control_plane->send(i, ServerMessage::TERMINATE);
         simgrid::s4u::this_actor::execute(0.03 * host_speed);
         // XBT_INFO("Step 5.%04d: Sent termination signal to client %d", i, i);
     }
+    checkpointer.drain();
+    validator.drain();
+    report["checkpoint"] = checkpointer.summary();
+    report["validation"] = validator.summary();
+    report["memory"] = server_memory->summary();
+    report["intra_node"] = intra_node->summary();
+    report["population"] = population->summary();
+    report["lateness"] = scheduler->lateness_summary();
+    report["lambda"] = scheduler->lambda_tuner->summary();
+    report["steps"] = global_step;
+    report["steps_per_hour"] = global_step * 3600.0 / simgrid::s4u::Engine::get_clock();
     XBT_INFO("Exiting.");
 }
 
 static void client(std::vector<std::string> args)
 {
-    // Create a random device to seed the generator
-    std::random_device rd;
+    xbt_assert(args.size() >= 7, "The client expects at least 7 arguments");
 
-    // Create a Mersenne Twister pseudo-random number generator
-    std::mt19937 gen(rd());
+    // Create a Mersenne Twister pseudo-random number generator, seeded per client by main() so that seeded runs repeat
+    std::mt19937 gen(std::stoul(args[6]));
 
     // Create a uniform_real_distribution to generate floating-point numbers between 1 and 2
     std::normal_distribution<double> dist(0, 0.12);
 
-    xbt_assert(args.size() >= 6, "The client expects at least 6 arguments");
-
     simgrid::s4u::Host *my_host = simgrid::s4u::this_actor::get_host();
 
     int client_id = std::stoi(args[0]);
@@ -682,28 +1007,46 @@ static void client(std::vector<std::string> args)
 
     simgrid::s4u::Mailbox *my_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(client_id));       // server -> client
     simgrid::s4u::Mailbox *server_mailbox = simgrid::s4u::Mailbox::by_name(std::to_string(num_clients)); // client -> server
+    simgrid::s4u::Mailbox *my_control = ControlPlane::mailbox(client_id);                                 // server -> client, control only
 
-    int *model_size = nullptr;
-    model_size = my_mailbox->get<int>();
-    int *num_local_steps = nullptr;
+    ServerMessage *message = nullptr;
+    ServerMessage *next_message = nullptr; // already received by a pipelined exchange
+    double carried_flops = 0.0;            // local training already done on the stale model
     while (true)
     {
         // XBT_INFO("Waiting for global model from server");
-        num_local_steps = my_mailbox->get<int>();
-        if (*num_local_steps < 0)
+        message = next_message ? next_message : ControlPlane::receive(my_mailbox, my_control);
+        next_message = nullptr;
+        if (message->kind == ServerMessage::TERMINATE)
         {
             XBT_INFO("Client has finished all epochs. Now terminating.");
+            delete message;
             break;
         }
         else{
-            XBT_INFO("Step 2.%04d: Received new global model from server (%d bytes) with %d step size", client_id, *model_size, *num_local_steps);
+            XBT_INFO("Step 2.%04d: Received new global model from server (%f bytes) with %d step size", client_id, message->model_size, message->local_steps);
         }
-        double local_training = per_step_training_cost * (*num_local_steps) * speed;
+        int model_size = static_cast<int>(message->model_size);
+        int num_local_steps = message->local_steps;
+        long round = message->round; // global step of the model being trained
+        delete message;
+        double received_at = simgrid::s4u::Engine::get_clock();
+        double local_training = per_step_training_cost * num_local_steps * speed;
         if (control != 0)
             local_training *= dist(gen);
-        simgrid::s4u::this_actor::execute(local_training);
-        XBT_INFO("Finished local training with %d step size, sending local model to the server", *num_local_steps);
-        server_mailbox->put(&client_id, *model_size); // send local model to server
+        simgrid::s4u::this_actor::execute(std::max(0.0, local_training - carried_flops));
+        XBT_INFO("Finished local training with %d step size, sending local model to the server", num_local_steps);
+        double upload_bytes = payload->bytes(model_size, round, true);
+        server_memory->reserve(upload_bytes);
+        intra_node->charge(client_id, upload_bytes);
+        LocalUpdate *local_update = new LocalUpdate{client_id, received_at, simgrid::s4u::Engine::get_clock(), upload_bytes};
+        if (pipeline->enabled)
+        {
+            double stale_training = per_step_training_cost * num_local_steps * speed;
+            next_message = pipeline->exchange(server_mailbox, local_update, model_size, round, my_mailbox, my_control, stale_training, carried_flops);
+            continue;
+        }
+        payload->put(server_mailbox, local_update, model_size, round, true); // send local model to server
         XBT_INFO("Step 3.%04d: Client %d sent local model to the server", client_id, client_id);
     }
 }
@@ -714,9 +1057,12 @@ int main(int argc, char *argv[])
 
     simgrid::s4u::Engine e(&argc, argv);
 
-    e.load_platform(argv[1]);
-
     json config = load_config(argv[2]);
+    if (config.contains("network_model"))
+        apply_network_model(config["network_model"]);
+
+    e.load_platform(argv[1]);
+    apply_wifi_rates(e);
 
     // Register server and client functions (for xml-based deployment)
     // e.register_function("server", &server);
@@ -730,6 +1076,7 @@ int main(int argc, char *argv[])
     long num_epochs = config.at("epochs").get<long>();
     double q_ratio = config.value("q_ratio", 0.2);
     double lambda_val = config.value("lambda", 1.5);
+    bool bandwidth_aware = config.value("bandwidth_aware", false);
     double dataloader_cost = config.at("dataloader_cost").get<double>();
     double aggregation_cost = config.at("aggregation_cost").get<double>();
     double validation_cost = config.value("validation_cost", 0.0);
@@ -737,6 +1084,13 @@ int main(int argc, char *argv[])
     double model_size = config.at("model_size").get<double>();
     int validation_flag = config.value("validation_flag", 0);
     int control = config.value("control", 0);
+    json checkpoint_settings = config.value("checkpoint", json::object());
+    long validation_interval = config.value("validation_interval", 1L);
+    std::string validation_mode = config.value("validation_mode", std::string("overlap"));
+    json memory_settings = config.value("memory", json::object());
+    json population_settings = config.value("population", json::object());
+    json intra_node_settings = config.value("intra_node", json::object());
+    unsigned seed = config.contains("seed") ? config["seed"].get<unsigned>() : std::random_device{}();
 
     json straggler_rules = config.contains("stragglers") ? config["stragglers"] : json::array();
     std::unordered_map<int, double> client_effects = parse_client_effects(straggler_rules, num_clients);
@@ -748,22 +1102,21 @@ int main(int argc, char *argv[])
         return it->second;
     };
 
-    // Create the server actor on host "Node-1"
-    std::vector<std::string> server_args = {std::to_string(num_clients), std::to_string(num_epochs), std::to_string(max_local_steps),
-                                            std::to_string(q_ratio), std::to_string(lambda_val), std::to_string(dataloader_cost), std::to_string(aggregation_cost),
-                                            std::to_string(validation_cost), std::to_string(model_size), std::to_string(validation_flag)};
-    simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
-
-    // Distribute clients across multiple nodes
+    // Distribute client slots across multiple nodes
     int client_id = 0;
+    std::vector<simgrid::s4u::Host *> slot_hosts;
+    std::vector<std::vector<std::string>> slot_args;
+    std::vector<double> slot_step_costs;
 
     for (int i = 0; i < num_clients_per_node - 1 && client_id < num_clients; ++i, ++client_id)
     {
         double multiplier = client_multiplier(client_id);
         std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(num_clients), std::to_string(max_local_steps),
                                                 std::to_string(dataloader_cost * multiplier), std::to_string(per_step_training_cost * multiplier),
-                                                std::to_string(control)};
-        simgrid::s4u::Actor::create("Client " + std::to_string(client_id), simgrid::s4u::Host::by_name("Node-1"), client, client_args);
+                                                std::to_string(control), std::to_string(seed + client_id)};
+        slot_hosts.push_back(simgrid::s4u::Host::by_name("Node-1"));
+        slot_args.push_back(client_args);
+        slot_step_costs.push_back(per_step_training_cost * multiplier);
     }
 
     int node_index = 2;
@@ -775,16 +1128,96 @@ int main(int argc, char *argv[])
             double multiplier = client_multiplier(client_id);
             std::vector<std::string> client_args = {std::to_string(client_id), std::to_string(num_clients), std::to_string(max_local_steps),
                                                     std::to_string(dataloader_cost * multiplier), std::to_string(per_step_training_cost * multiplier),
-                                                    std::to_string(control)};
-            simgrid::s4u::Actor::create("Client " + std::to_string(client_id), simgrid::s4u::Host::by_name(node_name), client, client_args);
+                                                    std::to_string(control), std::to_string(seed + client_id)};
+            slot_hosts.push_back(simgrid::s4u::Host::by_name(node_name));
+            slot_args.push_back(client_args);
+            slot_step_costs.push_back(per_step_training_cost * multiplier);
         }
         ++node_index;
     }
 
+    // Shadow mode: predict a live run from its progress events instead of simulating it
+    payload = new PayloadSchedule(config.value("payload_schedule", json::array()));
+    if (config.contains("shadow"))
+    {
+        const json &shadow = config["shadow"];
+        ShadowPredictor predictor(slot_step_costs, slot_hosts, simgrid::s4u::Host::by_name("Node-1"), model_size, shadow.value("momentum", 0.5));
+        std::string output_path = shadow.value("output", std::string());
+        std::ofstream output;
+        if (!output_path.empty())
+            output.open(output_path);
+        predictor.follow(shadow.at("events").get<std::string>(), output_path.empty() ? std::cout : output);
+        return 0;
+    }
+
+    // Create the server actor on host "Node-1"
+    std::vector<std::string> server_args = {std::to_string(num_clients), std::to_string(num_epochs), std::to_string(max_local_steps),
+                                            std::to_string(q_ratio), std::to_string(lambda_val), std::to_string(dataloader_cost), std::to_string(aggregation_cost),
+                                            std::to_string(validation_cost), std::to_string(model_size), std::to_string(validation_flag),
+                                            checkpoint_settings.dump(), std::to_string(validation_interval), validation_mode,
+                                            memory_settings.dump(), std::to_string(bandwidth_aware),
+                                            config.value("lambda_adaptive", json::object()).dump()};
+    simgrid::s4u::ActorPtr server_actor = simgrid::s4u::Actor::create("server", simgrid::s4u::Host::by_name("Node-1"), server, server_args);
+
+    pipeline = new ClientPipeline(config.value("client_pipeline", std::string("off")));
+    control_plane = new ControlPlane();
+    latency = new LatencyMetrics(config.value("latency", json::object()));
+    intra_node = new IntraNodeModel(intra_node_settings, simgrid::s4u::Host::by_name("Node-1"), slot_hosts);
+    if (config.contains("background"))
+    {
+        background = new BackgroundTraffic(config["background"], seed);
+        for (size_t i = 0; i < background->generators.size(); i++)
+        {
+            simgrid::s4u::ActorPtr generator = simgrid::s4u::Actor::create("background_" + std::to_string(i), simgrid::s4u::Host::by_name("Node-1"),
+                                                                           [i]() { background->run(i); });
+            generator->daemonize();
+        }
+    }
+    population = new Population(population_settings, num_clients, seed);
+    population->spawn = [slot_hosts, slot_args](int slot) {
+        simgrid::s4u::Actor::create("Client " + std::to_string(slot), slot_hosts[slot], client, slot_args[slot]);
+    };
+    for (int slot = 0; slot < population->initial; slot++)
+        population->start(slot);
+    if (population->dynamic())
+    {
+        simgrid::s4u::ActorPtr manager = simgrid::s4u::Actor::create("population_manager", simgrid::s4u::Host::by_name("Node-1"), []() { population->run(); });
+        manager->daemonize();
+    }
+
+    timeline = new TimelineChecksum();
+
+    if (config.contains("heartbeat"))
+    {
+        heartbeat = new Heartbeat(config["heartbeat"], num_epochs);
+        simgrid::s4u::Engine::on_time_advance_cb([](double) { heartbeat->tick(); });
+    }
+
     // Run the simulation
-    e.run();
+    if (config.contains("budget"))
+    {
+        budget = new Budget(config["budget"]);
+        budget->run(e, server_actor);
+    }
+    else
+        e.run();
 
     XBT_INFO("Simulation is over");
+    report["simulated_time"] = budget ? budget->end_time() : simgrid::s4u::Engine::get_clock();
+    if (budget)
+    {
+        report["truncated"] = !budget->stopped_by.empty();
+        report["budget"] = budget->summary();
+        report["completed"] = progress;
+    }
+    report["timeline"] = timeline->summary();
+    report["payload_phases"] = payload->summary();
+    report["control_plane"] = control_plane->summary();
+    report["latency"] = latency->summary();
+    if (background)
+        report["background"] = background->summary();
+    report["pipeline"] = pipeline->summary();
+    write_report(config.value("report_file", std::string()));
 
     return 0;
 }
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, University of California, Merced. All rights reserved.
+#
+# This file is part of the simulation software package developed by
+# the team members of Prof. Xiaoyi Lu's group at University of California, Merced.
+#
+# For detailed copyright and licensing information, please refer to the license
+# file LICENSE in the top level directory.
+
+"""Merge the latency sketches of several FedAvg, FedAsync or FedCompass reports.
+
+Each report holds one quantile sketch per metric under "latency" (round_trip, queueing, upload).
+Sketches with the same accuracy merge exactly by adding their bucket counts, so the quantiles of
+a whole sweep or of several replicas come out as if a single run had recorded every sample.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+
+def merge(sketches):
+    alphas = {sketch['alpha'] for sketch in sketches}
+    if len(alphas) != 1:
+        sys.exit(f'Cannot merge sketches of different accuracies: {sorted(alphas)}')
+    merged = {'alpha': alphas.pop(), 'count': 0, 'zeros': 0, 'min': math.inf, 'max': 0.0, 'sum': 0.0, 'buckets': {}}
+    for sketch in sketches:
+        if sketch['count'] == 0:
+            continue
+        merged['count'] += sketch['count']
+        merged['zeros'] += sketch['zeros']
+        merged['min'] = min(merged['min'], sketch['min'])
+        merged['max'] = max(merged['max'], sketch['max'])
+        merged['sum'] += sketch['mean'] * sketch['count']
+        for index, count in sketch['buckets'].items():
+            merged['buckets'][int(index)] = merged['buckets'].get(int(index), 0) + count
+    if merged['count'] == 0:
+        merged['min'] = 0.0
+    return merged
+
+
+def quantile(sketch, q):
+    """Same estimate as QuantileSketch::quantile in the simulators."""
+    if sketch['count'] == 0:
+        return 0.0
+    rank = int(q * (sketch['count'] - 1))
+    if rank < sketch['zeros']:
+        return 0.0
+    gamma = (1 + sketch['alpha']) / (1 - sketch['alpha'])
+    seen = sketch['zeros']
+    for index in sorted(sketch['buckets']):
+        seen += sketch['buckets'][index]
+        if seen > rank:
+            return min(max(2 * gamma ** index / (1 + gamma), sketch['min']), sketch['max'])
+    return sketch['max']
+
+
+def quantile_name(q):
+    """p50, p99, p999, ... as in the reports."""
+    return 'p' + f'{q:g}'.split('.')[-1].ljust(2, '0')
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description="Merge the latency sketches of several simulation reports")
+
+    parser.add_argument('reports', type=str, nargs='+', help='Report files written through "report_file"')
+    parser.add_argument('--quantiles', type=str, help='Comma-separated quantiles to report', required=False, default='0.5,0.99,0.999')
+    parser.add_argument('--keep_buckets', action='store_true', help='Keep the merged buckets, so that the output can be merged again')
+
+    args = parser.parse_args()
+    quantiles = [float(q) for q in args.quantiles.split(',')]
+
+    per_metric = {}
+    for path in args.reports:
+        with open(path, encoding='utf-8') as f:
+            report = json.load(f)
+        if 'latency' not in report:
+            sys.exit(f'{path} has no latency sketches')
+        for metric, sketch in report['latency'].items():
+            per_metric.setdefault(metric, []).append(sketch)
+
+    result = {}
+    for metric, sketches in sorted(per_metric.items()):
+        merged = merge(sketches)
+        summary = {'alpha': merged['alpha'], 'count': merged['count'], 'zeros': merged['zeros'], 'min': merged['min'], 'max': merged['max'],
+                   'mean': merged['sum'] / merged['count'] if merged['count'] else 0.0}
+        for q in quantiles:
+            summary[quantile_name(q)] = quantile(merged, q)
+        if args.keep_buckets:
+            summary['buckets'] = {str(index): count for index, count in sorted(merged['buckets'].items())}
+        result[metric] = summary
+
+    print(f'Merged {len(args.reports)} reports', file=sys.stderr)
+    print(json.dumps({'latency': result}, indent=4))
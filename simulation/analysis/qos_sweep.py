@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, University of California, Merced. All rights reserved.
+#
+# This file is part of the simulation software package developed by
+# the team members of Prof. Xiaoyi Lu's group at University of California, Merced.
+#
+# For detailed copyright and licensing information, please refer to the license
+# file LICENSE in the top level directory.
+
+"""Sweep the QoS weight of a FedAvg client group and print the round times of each run.
+
+QoS is FedAvg-only. The config's first "qos" client rule gets each weight of --weights in turn, and the
+other clients keep weight 1. The baseline is the same "qos" section with every class and client weight
+set to 1, not a run without QoS. QoS sends most of each transfer ahead of the mailbox rendezvous, which
+changes when uploads and downloads block, so only runs with QoS on compare with each other. The weights
+only change the round times when the favoured uploads contend with others for a link, e.g. the server
+NIC of a platform generated with --nic_bandwidth.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+
+def run(binary, platform, config):
+    """Run one simulation and return its report."""
+    with tempfile.TemporaryDirectory() as tmp:
+        config = dict(config, report_file=os.path.join(tmp, 'report.json'))
+        config_path = os.path.join(tmp, 'config.json')
+        with open(config_path, 'w', encoding='utf-8') as f:
+            json.dump(config, f)
+        # The XBT logs go to a file: a pipe would fill up and block the simulator
+        with open(os.path.join(tmp, 'run.log'), 'w+b') as log:
+            status = subprocess.call([binary, platform, config_path], stdout=log, stderr=subprocess.STDOUT)
+            if status != 0:
+                log.seek(0)
+                sys.exit(f'{binary} failed with status {status}:\n{log.read().decode(errors="replace")[-2000:]}')
+        with open(config['report_file'], encoding='utf-8') as f:
+            return json.load(f)
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description="Round times of FedAvg as a function of a QoS client weight")
+
+    parser.add_argument('--binary', type=str, help='FedAvg binary', required=False, default=os.path.join(ROOT, 'simulation', 'algorithm', 'bin', 'des_fedavg'))
+    parser.add_argument('--platform', type=str, help='Platform file', required=True)
+    parser.add_argument('--config', type=str, help='FedAvg config with a "qos" section', required=False, default=os.path.join(ROOT, 'config', 'fedavg_qos_config.json'))
+    parser.add_argument('--weights', type=str, help='Comma-separated weights of the first "qos" client rule', required=False, default='0.25,1,4,16')
+
+    args = parser.parse_args()
+
+    with open(args.config, encoding='utf-8') as f:
+        config = json.load(f)
+    if not config.get('qos', {}).get('clients'):
+        sys.exit(f'{args.config} has no "qos" client rule to sweep')
+
+    baseline = json.loads(json.dumps(config))
+    baseline['qos']['classes'] = {}
+    for rule in baseline['qos']['clients']:
+        rule['weight'] = 1.0
+    runs = [('equal weights', baseline)]
+    for weight in args.weights.split(','):
+        swept = json.loads(json.dumps(config))
+        swept['qos']['clients'][0]['weight'] = float(weight)
+        runs.append((f'weight {weight}', swept))
+
+    print(f'{"run":<14} {"mean round (s)":>15} {"max round (s)":>14} {"capped chunks":>14}')
+    for name, run_config in runs:
+        report = run(args.binary, args.platform, run_config)
+        round_times = report['round_times']
+        capped = report.get('qos', {}).get('capped_chunks', 0)
+        print(f'{name:<14} {statistics.mean(round_times):>15.4f} {max(round_times):>14.4f} {capped:>14}')
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, University of California, Merced. All rights reserved.
+#
+# This file is part of the simulation software package developed by
+# the team members of Prof. Xiaoyi Lu's group at University of California, Merced.
+#
+# For detailed copyright and licensing information, please refer to the license
+# file LICENSE in the top level directory.
+
+"""Fit SimGrid network model parameters to measured point-to-point transfer times.
+
+SimGrid predicts the time of an isolated transfer of `size` bytes over a route of latency `L`
+and bottleneck bandwidth `B` as
+
+    time = latency_factor * L + size / min(bandwidth_factor * B, tcp_gamma / (2 * L))
+
+The factors are fitted by weighted least squares on the relative error, either once for all
+sizes or per size range (piecewise). The result is a "network_model" config section that the
+FedAvg, FedAsync and FedCompass binaries apply before loading the platform.
+"""
+
+import argparse
+import csv
+import json
+import re
+import sys
+
+# Defaults of SimGrid's LV08 network model
+DEFAULT_LATENCY_FACTOR = 13.01
+DEFAULT_BANDWIDTH_FACTOR = 0.97
+DEFAULT_TCP_GAMMA = 4194304.0
+
+UNITS = {
+    'bps': 1 / 8, 'kbps': 1e3 / 8, 'mbps': 1e6 / 8, 'gbps': 1e9 / 8, 'tbps': 1e12 / 8,
+    'Bps': 1, 'kBps': 1e3, 'KBps': 1e3, 'MBps': 1e6, 'GBps': 1e9, 'TBps': 1e12,
+    'KiBps': 2**10, 'MiBps': 2**20, 'GiBps': 2**30, 'TiBps': 2**40,
+    'Kbps': 1e3 / 8, 'Mbps': 1e6 / 8, 'Gbps': 1e9 / 8, 'Tbps': 1e12 / 8,
+    's': 1, 'ms': 1e-3, 'us': 1e-6, 'ns': 1e-9, 'ps': 1e-12,
+}
+
+
+def parse_value(text):
+    """Parse a SimGrid quantity such as '200GBps' or '5us' into bytes/s or seconds."""
+    match = re.fullmatch(r'\s*([0-9.eE+-]+)\s*([A-Za-z]*)\s*', str(text))
+    if not match:
+        raise ValueError(f'Cannot parse value {text!r}')
+    number, unit = match.groups()
+    if unit and unit not in UNITS:
+        raise ValueError(f'Unknown unit {unit!r} in {text!r}')
+    return float(number) * UNITS.get(unit, 1)
+
+
+def load_measurements(path, latency, bandwidth):
+    """Read `size,time[,latency,bandwidth]` rows (bytes, seconds); missing route values use the defaults."""
+    rows = []
+    with open(path, newline='', encoding='utf-8') as f:
+        for record in csv.DictReader(f):
+            rows.append({
+                'size': float(record['size']),
+                'time': float(record['time']),
+                'latency': parse_value(record['latency']) if record.get('latency') else latency,
+                'bandwidth': parse_value(record['bandwidth']) if record.get('bandwidth') else bandwidth,
+            })
+    if not rows:
+        sys.exit(f'No measurements in {path}')
+    return rows
+
+
+def predict(row, latency_factor, bandwidth_factor, tcp_gamma):
+    rate = bandwidth_factor * row['bandwidth']
+    if tcp_gamma:
+        rate = min(rate, tcp_gamma / (2 * row['latency']))
+    return latency_factor * row['latency'] + row['size'] / rate
+
+
+def fit_segment(rows):
+    """Fit time = a + b * size with weights 1 / time^2, and turn a and b into the two factors."""
+    if len({row['size'] for row in rows}) < 2:
+        sys.exit(f'Each size range needs at least two distinct message sizes (got {len(rows)} rows of size {rows[0]["size"]:g})')
+    w = [1 / row['time'] ** 2 for row in rows]
+    sw = sum(w)
+    sx = sum(wi * row['size'] for wi, row in zip(w, rows))
+    sy = sum(wi * row['time'] for wi, row in zip(w, rows))
+    sxx = sum(wi * row['size'] ** 2 for wi, row in zip(w, rows))
+    sxy = sum(wi * row['size'] * row['time'] for wi, row in zip(w, rows))
+    slope = (sw * sxy - sx * sy) / (sw * sxx - sx * sx)
+    intercept = (sy - slope * sx) / sw
+    if slope <= 0:
+        sys.exit('Transfer time does not grow with the message size; check the measurements')
+    intercept = max(intercept, 0.0)
+    latency = sum(row['latency'] for row in rows) / len(rows)
+    bandwidth = sum(row['bandwidth'] for row in rows) / len(rows)
+    return intercept / latency, 1 / (slope * bandwidth)
+
+
+def fit_tcp_gamma(rows, factors, breakpoints):
+    """Scan TCP gamma on a log grid; only meaningful when the routes have different latencies."""
+    best, best_error = None, relative_errors(rows, factors, None, breakpoints)[0]
+    gamma = 1024.0
+    while gamma < 1e12:
+        error = relative_errors(rows, factors, gamma, breakpoints)[0]
+        if error < best_error:
+            best, best_error = gamma, error
+        gamma *= 1.25
+    return best
+
+
+def segment_of(size, breakpoints):
+    index = 0
+    while index < len(breakpoints) and size >= breakpoints[index]:
+        index += 1
+    return index
+
+
+def relative_errors(rows, factors, tcp_gamma, breakpoints=()):
+    errors = []
+    for row in rows:
+        latency_factor, bandwidth_factor = factors[segment_of(row['size'], breakpoints)]
+        errors.append(abs(predict(row, latency_factor, bandwidth_factor, tcp_gamma) - row['time']) / row['time'])
+    return sum(errors) / len(errors), max(errors)
+
+
+def piecewise(values, breakpoints):
+    """SimGrid's size-dependent factor syntax: 'min_size:value;min_size:value;...'."""
+    thresholds = [0] + list(breakpoints)
+    return ';'.join(f'{int(threshold)}:{value:.6g}' for threshold, value in zip(thresholds, values))
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description="Calibrate the SimGrid network model against measured point-to-point transfers")
+
+    parser.add_argument('--measurements', type=str, help='CSV with size (bytes) and time (s) columns, and optional per-row latency and bandwidth', required=True)
+    parser.add_argument('--bandwidth', type=str, help='Bottleneck bandwidth of the measured route', required=False, default='200GBps')
+    parser.add_argument('--latency', type=str, help='Latency of the measured route', required=False, default='5us')
+    parser.add_argument('--breakpoints', type=str, help='Comma-separated message sizes (bytes) starting a new piecewise segment', required=False, default='')
+    parser.add_argument('--tcp_gamma', type=float, help='TCP window bound (bytes); fitted when the routes have several latencies', required=False, default=None)
+    parser.add_argument('--update', type=str, nargs='*', help='Config files to write the network_model section into', required=False, default=[])
+
+    args = parser.parse_args()
+
+    rows = load_measurements(args.measurements, parse_value(args.latency), parse_value(args.bandwidth))
+    breakpoints = sorted(float(size) for size in args.breakpoints.split(',') if size.strip())
+
+    segments = [[] for _ in range(len(breakpoints) + 1)]
+    for row in rows:
+        segments[segment_of(row['size'], breakpoints)].append(row)
+    factors = [fit_segment(segment) for segment in segments]
+
+    tcp_gamma = args.tcp_gamma
+    if tcp_gamma is None and len({row['latency'] for row in rows}) > 1:
+        tcp_gamma = fit_tcp_gamma(rows, factors, breakpoints)
+
+    if breakpoints:
+        model = {'latency_factor': piecewise([lf for lf, _ in factors], breakpoints),
+                 'bandwidth_factor': piecewise([bf for _, bf in factors], breakpoints)}
+    else:
+        model = {'latency_factor': factors[0][0], 'bandwidth_factor': factors[0][1]}
+    if tcp_gamma is not None:
+        model['tcp_gamma'] = tcp_gamma
+
+    default_mean, default_max = relative_errors(rows, [(DEFAULT_LATENCY_FACTOR, DEFAULT_BANDWIDTH_FACTOR)], DEFAULT_TCP_GAMMA)
+    fitted_mean, fitted_max = relative_errors(rows, factors, tcp_gamma, breakpoints)
+    print(f'Default model: mean relative error {default_mean:.2%}, max {default_max:.2%}', file=sys.stderr)
+    print(f'Fitted model:  mean relative error {fitted_mean:.2%}, max {fitted_max:.2%}', file=sys.stderr)
+
+    for path in args.update:
+        with open(path, encoding='utf-8') as f:
+            config = json.load(f)
+        config['network_model'] = model
+        with open(path, 'w', encoding='utf-8') as f:
+            json.dump(config, f, indent=2)
+            f.write('\n')
+        print(f'Wrote network_model to {path}', file=sys.stderr)
+
+    print(json.dumps({'network_model': model}, indent=4))
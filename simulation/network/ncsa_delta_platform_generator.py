@@ -14,33 +14,125 @@ import xml.etree.ElementTree as ET
 import xml.dom.minidom
 import argparse
 
-def create_platform_xml(num_nodes, output_file, bandwidth, latency):
+def traffic_pairs(num_nodes, traffic='full', group_size=8):
+    """Node pairs (i < j) that exchange messages under the given traffic pattern.
+
+    star:      the server (Node-1) with every other node
+    hierarchy: star, plus every node with the leader of its group of `group_size` consecutive nodes
+    full:      every pair of nodes
+    """
+    if traffic == 'full':
+        return [(i, j) for i in range(1, num_nodes + 1) for j in range(i + 1, num_nodes + 1)]
+    pairs = {(1, j) for j in range(2, num_nodes + 1)}
+    if traffic == 'hierarchy':
+        for j in range(2, num_nodes + 1):
+            leader = (j - 1) // group_size * group_size + 1
+            if leader != j:
+                pairs.add((leader, j))
+    return sorted(pairs)
+
+def station_levels(num_stations, rate_mix):
+    """Rate level of each station of a cell, so that the share of stations at level k follows rate_mix[k]."""
+    total = sum(rate_mix)
+    levels = []
+    for station in range(num_stations):
+        position, level, cumulative = (station + 0.5) / num_stations * total, 0, rate_mix[0]
+        while position > cumulative and level + 1 < len(rate_mix):
+            level += 1
+            cumulative += rate_mix[level]
+        levels.append(level)
+    return levels
+
+def add_wifi_cells(platform, num_nodes, num_cells, wifi_rates, rate_mix, wan_bandwidth, wan_latency, cores):
+    """Attach the client nodes Node-2..Node-<num_nodes> to the server through shared wireless cells.
+
+    The nodes are split into `num_cells` WIFI zones of consecutive nodes. Each cell has an access point
+    and one WIFI link shared by its stations, then a WAN link from the access point to Node-1. Returns
+    the wired zone that Node-1 goes in.
+    """
+    world = ET.SubElement(platform, 'zone', id='world', routing='Full')
+    # The cells only reach the server; background traffic reads this to pick routed host pairs
+    ET.SubElement(world, 'prop', id='traffic', value='star')
+    core = ET.SubElement(world, 'zone', id='zone0', routing='Full')
+    clients = list(range(2, num_nodes + 1))
+    cells = [clients[c * len(clients) // num_cells:(c + 1) * len(clients) // num_cells] for c in range(num_cells)]
+    for c, nodes in enumerate(cells, start=1):
+        if not nodes:
+            continue
+        cell = ET.SubElement(world, 'zone', id=f'cell-{c}', routing='Wifi')
+        ET.SubElement(cell, 'prop', id='access_point', value=f'cell-{c}-ap')
+        for i, level in zip(nodes, station_levels(len(nodes), rate_mix)):
+            host = ET.SubElement(cell, 'host', id=f'Node-{i}', speed='2445Mf', core=str(cores))
+            # Read by the simulators, which set the station's rate level on the cell's WIFI link
+            ET.SubElement(host, 'prop', id='wifi_link', value=f'cell-{c}-wifi')
+            ET.SubElement(host, 'prop', id='wifi_rate', value=str(level))
+        ET.SubElement(cell, 'link', id=f'cell-{c}-wifi', sharing_policy='WIFI', bandwidth=wifi_rates, latency='0ms')
+        ET.SubElement(cell, 'router', id=f'cell-{c}-ap')
+    for c, nodes in enumerate(cells, start=1):
+        if nodes:
+            ET.SubElement(world, 'link', id=f'cell-{c}-wan', bandwidth=wan_bandwidth, latency=wan_latency)
+    for c, nodes in enumerate(cells, start=1):
+        if nodes:
+            route = ET.SubElement(world, 'zoneRoute', src=f'cell-{c}', dst='zone0', gw_src=f'cell-{c}-ap', gw_dst='Node-1')
+            ET.SubElement(route, 'link_ctn', id=f'cell-{c}-wan')
+    return core
+
+def create_platform_xml(num_nodes, output_file, bandwidth, latency, disk_bandwidth=None, cores=1, nic_bandwidth=None, nic_latency='0us', memory_bandwidth=None, memory_latency='100ns', traffic='full', group_size=8,
+                        wifi_cells=0, wifi_rates='54Mbps,36Mbps,24Mbps', wifi_rate_mix=(1.0,), wan_bandwidth='100Mbps', wan_latency='20ms'):
     platform = ET.Element('platform', version='4.1')
-    zone = ET.SubElement(platform, 'zone', id='zone0', routing='Full')
+    if wifi_cells:
+        # Only the server stays on the wired fabric; the clients reach it through their cell
+        zone = add_wifi_cells(platform, num_nodes, wifi_cells, wifi_rates, wifi_rate_mix, wan_bandwidth, wan_latency, cores)
+        num_nodes, nic_bandwidth = 1, None
+    else:
+        zone = ET.SubElement(platform, 'zone', id='zone0', routing='Full')
+        # Background traffic reads the pattern to pick random endpoints among the routed host pairs
+        ET.SubElement(zone, 'prop', id='traffic', value=traffic)
+        if traffic == 'hierarchy':
+            ET.SubElement(zone, 'prop', id='group_size', value=str(group_size))
 
     # Create hosts
     for i in range(1, num_nodes + 1):
-        ET.SubElement(zone, 'host', id=f'Node-{i}', speed='2445Mf')
+        host = ET.SubElement(zone, 'host', id=f'Node-{i}', speed='2445Mf', core=str(cores))
+        # Attach a checkpoint disk to the server host
+        if i == 1 and disk_bandwidth:
+            ET.SubElement(host, 'disk', id='ckpt', read_bw=disk_bandwidth, write_bw=disk_bandwidth)
+
+    # Create one link per pair of nodes that communicate
+    pairs = traffic_pairs(num_nodes, traffic, group_size)
+    for link_id in range(1, len(pairs) + 1):
+        ET.SubElement(zone, 'link', id=str(link_id), bandwidth=bandwidth, latency=latency)
 
-    # Create links
-    for i in range(1, num_nodes * (num_nodes+1)):
-        ET.SubElement(zone, 'link', id=str(i), bandwidth=bandwidth, latency=latency)
+    # Create one split-duplex NIC per host, so that all the flows entering (or leaving) a host share its capacity
+    if nic_bandwidth:
+        for i in range(1, num_nodes + 1):
+            ET.SubElement(zone, 'link', id=f'Node-{i}-nic', bandwidth=nic_bandwidth, latency=nic_latency, sharing_policy='SPLITDUPLEX')
 
-    # Create loopback link
-    ET.SubElement(zone, 'link', id='loopback', bandwidth=bandwidth, latency='1us', sharing_policy='FATPIPE')
+    if memory_bandwidth:
+        # Intra-node transfers share the memory bandwidth of their own host
+        for i in range(1, num_nodes + 1):
+            ET.SubElement(zone, 'link', id=f'Node-{i}-mem', bandwidth=memory_bandwidth, latency=memory_latency, sharing_policy='SHARED')
+    else:
+        # Create loopback link
+        ET.SubElement(zone, 'link', id='loopback', bandwidth=bandwidth, latency='1us', sharing_policy='FATPIPE')
 
     # Create routes for loopback
     for i in range(1, num_nodes + 1):
         route = ET.SubElement(zone, 'route', src=f'Node-{i}', dst=f'Node-{i}')
-        ET.SubElement(route, 'link_ctn', id='loopback')
+        ET.SubElement(route, 'link_ctn', id=f'Node-{i}-mem' if memory_bandwidth else 'loopback')
 
     # Create routes between nodes
-    link_id = 1
-    for i in range(1, num_nodes + 1):
-        for j in range(i + 1, num_nodes + 1):
+    for link_id, (i, j) in enumerate(pairs, start=1):
+        if nic_bandwidth:
+            # Source NIC up, fabric link, destination NIC down; one explicit route per direction
+            for src, dst in ((i, j), (j, i)):
+                route = ET.SubElement(zone, 'route', src=f'Node-{src}', dst=f'Node-{dst}', symmetrical='NO')
+                ET.SubElement(route, 'link_ctn', id=f'Node-{src}-nic', direction='UP')
+                ET.SubElement(route, 'link_ctn', id=str(link_id))
+                ET.SubElement(route, 'link_ctn', id=f'Node-{dst}-nic', direction='DOWN')
+        else:
             route = ET.SubElement(zone, 'route', src=f'Node-{i}', dst=f'Node-{j}')
             ET.SubElement(route, 'link_ctn', id=str(link_id))
-            link_id += 1
 
     # Convert ElementTree to a string
     xml_str = ET.tostring(platform, encoding='utf-8')
@@ -52,6 +144,11 @@ def create_platform_xml(num_nodes, output_file, bandwidth, latency):
     with open(output_file, 'w', encoding='utf-8') as f:
         f.write(pretty_xml_as_string)
 
+    if wifi_cells:
+        print(f'{len(platform.findall(".//zoneRoute"))} wireless cells, each behind its own WAN link')
+    else:
+        print(f'{traffic} traffic: {len(zone.findall("link"))} links, {len(zone.findall("route"))} routes')
+
 if __name__ == '__main__':
 
     parser = argparse.ArgumentParser(description="The generator for the client-server XML")
@@ -61,6 +158,19 @@ if __name__ == '__main__':
     parser.add_argument('--output_file', type=str, help='Output file name', required=True, default=f'delta_client_server_128.xml')
     parser.add_argument('--bandwidth', type=str, help='The bandwidth of the platform', required=False, default='200GBps')
     parser.add_argument('--latency', type=str, help='The latency of the platform', required=False, default='5us')
+    parser.add_argument('--nic_bandwidth', type=str, help='Per-host NIC bandwidth in each direction (no NIC bottleneck if omitted)', required=False, default=None)
+    parser.add_argument('--nic_latency', type=str, help='Per-host NIC latency', required=False, default='0us')
+    parser.add_argument('--memory_bandwidth', type=str, help='Per-host memory bandwidth shared by intra-node transfers (contention-free loopback if omitted)', required=False, default=None)
+    parser.add_argument('--memory_latency', type=str, help='Latency of an intra-node transfer', required=False, default='100ns')
+    parser.add_argument('--traffic', type=str, choices=['star', 'hierarchy', 'full'], help='Traffic pattern; only the routes it uses are emitted', required=False, default='full')
+    parser.add_argument('--group_size', type=int, help='Nodes per group for the hierarchy traffic pattern', required=False, default=8)
+    parser.add_argument('--cores', type=int, help='Number of cores per node', required=False, default=1)
+    parser.add_argument('--wifi_cells', type=int, help='Number of wireless cells the client nodes (Node-2 onward) are split into; all nodes are wired if 0', required=False, default=0)
+    parser.add_argument('--wifi_rates', type=str, help='Comma-separated bandwidth of each rate level of a cell, fastest first', required=False, default='54Mbps,36Mbps,24Mbps')
+    parser.add_argument('--wifi_rate_mix', type=str, help='Comma-separated share of the stations of a cell at each rate level', required=False, default='1')
+    parser.add_argument('--wan_bandwidth', type=str, help='Bandwidth of the WAN link from each access point to the server', required=False, default='100Mbps')
+    parser.add_argument('--wan_latency', type=str, help='Latency of the WAN link from each access point to the server', required=False, default='20ms')
+    parser.add_argument('--disk_bandwidth', type=str, help='Bandwidth of the checkpoint disk attached to Node-1 (no disk if omitted)', required=False, default=None)
 
     args = parser.parse_args()
     num_nodes = args.num_nodes
@@ -68,7 +178,19 @@ if __name__ == '__main__':
     output_file = args.output_file
     bandwidth = args.bandwidth
     latency = args.latency
+    disk_bandwidth = args.disk_bandwidth
+    cores = args.cores
+    nic_bandwidth = args.nic_bandwidth
+    nic_latency = args.nic_latency
+    memory_bandwidth = args.memory_bandwidth
+    memory_latency = args.memory_latency
+    traffic = args.traffic
+    group_size = args.group_size
+    wifi_rate_mix = [float(share) for share in args.wifi_rate_mix.split(',')]
+    if len(wifi_rate_mix) > len(args.wifi_rates.split(',')):
+        parser.error('--wifi_rate_mix has more shares than --wifi_rates has levels')
 
     print(f'Creating platform xml for {num_nodes} nodes')
-    create_platform_xml(num_nodes, output_file, bandwidth, latency)
+    create_platform_xml(num_nodes, output_file, bandwidth, latency, disk_bandwidth, cores, nic_bandwidth, nic_latency, memory_bandwidth, memory_latency, traffic, group_size,
+                        args.wifi_cells, args.wifi_rates, wifi_rate_mix, args.wan_bandwidth, args.wan_latency)
     print(f'Platform XML created at {output_file}')
\ No newline at end of file
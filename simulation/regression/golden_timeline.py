@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (c) 2025, University of California, Merced. All rights reserved.
+#
+# This file is part of the simulation software package developed by
+# the team members of Prof. Xiaoyi Lu's group at University of California, Merced.
+#
+# For detailed copyright and licensing information, please refer to the license
+# file LICENSE in the top level directory.
+
+"""Check that a simulator change leaves the simulated results unchanged, and does not slow it down.
+
+Each case runs one config of config/ through its binary with a fixed seed, and compares the
+report against the stored golden:
+- the timeline checksum ("timeline" in the report) must match exactly;
+- if it does not, the case still passes with a warning when the simulated time and the FedAvg
+  round times stay within --tolerance (relative), e.g. after a change that only reorders
+  simultaneous events; it fails otherwise;
+- the wall time and peak RSS of the simulator must not grow by more than --wall_threshold and
+  --rss_threshold (relative) over the golden.
+
+The checksum goldens (goldens.json) do not depend on the machine and are committed. The wall-time
+and RSS baselines (perf_baseline.json) are only comparable on the same machine and build flags, so
+they stay local: --update records both, and the resource check is skipped when there is no local
+baseline.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# name: (binary, config)
+CASES = {
+    'fedavg': ('des_fedavg', 'fedavg_config.json'),
+    'fedasync': ('des_fedasync', 'fedasync_config.json'),
+    'fedcompass': ('des_fedcompass', 'fedcompass_config.json'),
+}
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+
+
+def run_case(binary, config, platform):
+    """Run one simulation; return its report, wall time (s) and peak RSS (MiB)."""
+    with tempfile.TemporaryDirectory() as tmp:
+        config = dict(config, report_file=os.path.join(tmp, 'report.json'))
+        config_path = os.path.join(tmp, 'config.json')
+        with open(config_path, 'w', encoding='utf-8') as f:
+            json.dump(config, f)
+        # The XBT logs go to a file: a pipe would fill up and block the simulator
+        with open(os.path.join(tmp, 'run.log'), 'w+b') as log:
+            start = time.monotonic()
+            process = subprocess.Popen([binary, platform, config_path], stdout=log, stderr=subprocess.STDOUT)
+            # wait4 gives the resource usage of this child only, unlike getrusage(RUSAGE_CHILDREN)
+            _, status, usage = os.wait4(process.pid, 0)
+            wall_time = time.monotonic() - start
+            if os.waitstatus_to_exitcode(status) != 0:
+                log.seek(0)
+                tail = log.read().decode(errors='replace')[-2000:]
+                sys.exit(f'{binary} failed with status {os.waitstatus_to_exitcode(status)}:\n{tail}')
+        with open(config['report_file'], encoding='utf-8') as f:
+            report = json.load(f)
+    # ru_maxrss is in KiB on Linux but in bytes on macOS
+    return report, wall_time, usage.ru_maxrss / (2**20 if sys.platform == 'darwin' else 2**10)
+
+
+def result_of(report, wall_time, rss):
+    result = {'checksum': report['timeline']['checksum'], 'events': report['timeline']['events'],
+              'simulated_time': report['simulated_time'], 'wall_time': wall_time, 'rss_mib': rss}
+    if 'round_times' in report:
+        result['round_times'] = report['round_times']
+    return result
+
+
+def load(path):
+    if not os.path.exists(path):
+        return {}
+    with open(path, encoding='utf-8') as f:
+        return json.load(f)
+
+
+def save(path, results):
+    with open(path, 'w', encoding='utf-8') as f:
+        json.dump(results, f, indent=4)
+        f.write('\n')
+    print(f'Wrote {path}', file=sys.stderr)
+
+
+def within(value, golden, tolerance):
+    return abs(value - golden) <= tolerance * max(abs(golden), 1e-12)
+
+
+def compare(name, result, golden, baseline, args):
+    """Print the verdict of one case against its golden and, if any, its local baseline; return False if it fails."""
+    ok = True
+    if result['checksum'] == golden['checksum']:
+        print(f'[{name}] timeline matches ({result["events"]} events)')
+    else:
+        times = [(result['simulated_time'], golden['simulated_time'])]
+        times += list(zip(result.get('round_times', []), golden.get('round_times', [])))
+        same_rounds = len(result.get('round_times', [])) == len(golden.get('round_times', []))
+        if same_rounds and all(within(value, expected, args.tolerance) for value, expected in times):
+            print(f'[{name}] WARNING: timeline checksum changed ({golden["checksum"]} -> {result["checksum"]}, '
+                  f'{golden["events"]} -> {result["events"]} events), but the simulated times are within {args.tolerance:g}')
+        else:
+            print(f'[{name}] FAIL: simulated time {golden["simulated_time"]:.6f} -> {result["simulated_time"]:.6f}, '
+                  f'timeline checksum {golden["checksum"]} -> {result["checksum"]}')
+            ok = False
+
+    if baseline is None:
+        print(f'[{name}] no local wall-time/RSS baseline in {args.baseline}, skipping the resource check')
+        return ok
+    for key, threshold, unit in (('wall_time', args.wall_threshold, 's'), ('rss_mib', args.rss_threshold, 'MiB')):
+        growth = result[key] / baseline[key] - 1 if baseline[key] > 0 else 0.0
+        line = f'{key} {baseline[key]:.2f} -> {result[key]:.2f} {unit} ({growth:+.1%})'
+        if growth > threshold:
+            print(f'[{name}] FAIL: {line}, above the {threshold:.0%} threshold')
+            ok = False
+        else:
+            print(f'[{name}] {line}')
+    return ok
+
+
+if __name__ == '__main__':
+
+    parser = argparse.ArgumentParser(description="Compare seeded FedAvg/FedAsync/FedCompass runs against golden timelines")
+
+    parser.add_argument('--bin_dir', type=str, help='Directory of the des_fedavg, des_fedasync and des_fedcompass binaries', required=False,
+                        default=os.path.join(ROOT, 'simulation', 'algorithm', 'bin'))
+    parser.add_argument('--platform', type=str, help='Platform file', required=False, default=os.path.join(ROOT, 'resources', 'delta_platform.xml'))
+    parser.add_argument('--goldens', type=str, help='Golden timeline file (committed)', required=False, default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'goldens.json'))
+    parser.add_argument('--baseline', type=str, help='Wall-time and RSS baseline file (local to the machine)', required=False,
+                        default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'perf_baseline.json'))
+    parser.add_argument('--cases', type=str, help='Comma-separated subset of ' + ','.join(CASES), required=False, default=','.join(CASES))
+    parser.add_argument('--seed', type=int, help='Seed of every run', required=False, default=1)
+    parser.add_argument('--epochs', type=int, help='Override the epochs of the configs to keep the runs short', required=False, default=None)
+    parser.add_argument('--tolerance', type=float, help='Relative tolerance on simulated times when the checksum differs', required=False, default=1e-9)
+    parser.add_argument('--wall_threshold', type=float, help='Allowed relative wall-time growth', required=False, default=0.10)
+    parser.add_argument('--rss_threshold', type=float, help='Allowed relative peak RSS growth', required=False, default=0.10)
+    parser.add_argument('--repeat', type=int, help='Runs per case; the fastest wall time and smallest RSS are kept', required=False, default=1)
+    parser.add_argument('--update', action='store_true', help='Record the results as the new goldens instead of comparing')
+
+    args = parser.parse_args()
+
+    goldens = load(args.goldens)
+    baselines = load(args.baseline)
+    if not goldens and not args.update:
+        sys.exit(f'No goldens at {args.goldens}; record them first with --update (see "Regression Checks" in the README)')
+
+    failed = []
+    for name in args.cases.split(','):
+        if name not in CASES:
+            sys.exit(f'Unknown case {name!r}, expected one of {", ".join(CASES)}')
+        binary, config_name = CASES[name]
+        with open(os.path.join(ROOT, 'config', config_name), encoding='utf-8') as f:
+            config = json.load(f)
+        config['seed'] = args.seed
+        if args.epochs is not None:
+            config['epochs'] = args.epochs
+
+        results = [result_of(*run_case(os.path.join(args.bin_dir, binary), config, args.platform)) for _ in range(args.repeat)]
+        result = dict(results[0], wall_time=min(r['wall_time'] for r in results), rss_mib=min(r['rss_mib'] for r in results))
+        if any(r['checksum'] != result['checksum'] for r in results):
+            print(f'[{name}] FAIL: repeated runs of the same seed have different timelines')
+            failed.append(name)
+
+        if args.update:
+            goldens[name] = {key: value for key, value in result.items() if key not in ('wall_time', 'rss_mib')}
+            goldens[name].update(seed=args.seed, epochs=config['epochs'])
+            baselines[name] = dict(wall_time=result['wall_time'], rss_mib=result['rss_mib'], seed=args.seed, epochs=config['epochs'])
+            print(f'[{name}] recorded {result["checksum"]} ({result["events"]} events, {result["wall_time"]:.2f} s, {result["rss_mib"]:.1f} MiB)')
+            continue
+        if name not in goldens:
+            sys.exit(f'No golden for {name}; record it with --update')
+        golden = goldens[name]
+        if (golden['seed'], golden['epochs']) != (args.seed, config['epochs']):
+            sys.exit(f'The {name} golden was recorded with seed {golden["seed"]} and {golden["epochs"]} epochs; run with the same --seed and --epochs')
+        baseline = baselines.get(name)
+        if baseline is not None and (baseline['seed'], baseline['epochs']) != (args.seed, config['epochs']):
+            baseline = None
+        if not compare(name, result, golden, baseline, args):
+            failed.append(name)
+
+    if args.update and not failed:
+        save(args.goldens, goldens)
+        save(args.baseline, baselines)
+
+    if failed:
+        sys.exit(f'Regressions in: {", ".join(failed)}')